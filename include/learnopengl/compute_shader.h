@@ -0,0 +1,85 @@
+#ifndef COMPUTE_SHADER_H
+#define COMPUTE_SHADER_H
+
+#include <glad/glad.h>
+#include <learnopengl/shader_s.h>
+
+#include <string>
+#include <string_view>
+
+// a program with only a compute stage (GL 4.3, or GL_ARB_compute_shader),
+// for work like mip generation or particle updates that would otherwise run
+// on the CPU. the uniform setters are those of Shader.
+//
+// what a dispatch writes through images or storage buffers is only visible
+// to later GL work after a glMemoryBarrier naming how it will be read, so
+// every dispatch takes those bits and issues the barrier right after it:
+//   GL_SHADER_STORAGE_BARRIER_BIT       a later shader reads the buffer
+//   GL_SHADER_IMAGE_ACCESS_BARRIER_BIT  a later shader reads the image
+//   GL_TEXTURE_FETCH_BARRIER_BIT        the image is sampled as a texture
+//   GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT  the buffer is drawn as vertices
+//   GL_COMMAND_BARRIER_BIT              it holds indirect draw/dispatch commands
+//   GL_BUFFER_UPDATE_BARRIER_BIT        the CPU reads it back (glGetBufferSubData, mapping)
+class ComputeShader : public Shader
+{
+public:
+    unsigned int groupSize[3] = {1, 1, 1}; // the shader's local_size_x/y/z
+
+    explicit ComputeShader(const char *computePath)
+    {
+        std::string computeCode;
+        readFile(computePath, computeCode);
+        build(computeCode);
+    }
+    static ComputeShader fromSource(std::string_view computeCode)
+    {
+        ComputeShader shader;
+        shader.build(computeCode);
+        return shader;
+    }
+    // false on contexts without compute shaders (e.g. GL 3.3 or macOS)
+    static bool supported()
+    {
+        return GLAD_GL_ARB_compute_shader != 0;
+    }
+
+    // run x * y * z work groups
+    void dispatch(unsigned int x, unsigned int y = 1, unsigned int z = 1, GLbitfield barriers = 0)
+    {
+        use();
+        glDispatchCompute(x, y, z);
+        if (barriers)
+            glMemoryBarrier(barriers);
+    }
+    // run enough work groups to cover width * height * depth invocations; the
+    // shader has to skip the ones past the edge
+    void dispatchThreads(unsigned int width, unsigned int height = 1, unsigned int depth = 1, GLbitfield barriers = 0)
+    {
+        dispatch((width + groupSize[0] - 1) / groupSize[0], (height + groupSize[1] - 1) / groupSize[1],
+                 (depth + groupSize[2] - 1) / groupSize[2], barriers);
+    }
+    // take the group counts from the buffer bound to GL_DISPATCH_INDIRECT_BUFFER,
+    // e.g. written by an earlier dispatch (with GL_COMMAND_BARRIER_BIT)
+    void dispatchIndirect(GLintptr offset, GLbitfield barriers = 0)
+    {
+        use();
+        glDispatchComputeIndirect(offset);
+        if (barriers)
+            glMemoryBarrier(barriers);
+    }
+
+private:
+    ComputeShader() = default;
+
+    void build(std::string_view computeCode)
+    {
+        ShaderStages stages;
+        stages.compute = computeCode;
+        Shader::build(stages);
+        int size[3] = {1, 1, 1};
+        glGetProgramiv(ID, GL_COMPUTE_WORK_GROUP_SIZE, size);
+        for (int i = 0; i < 3; ++i)
+            groupSize[i] = size[i] > 0 ? (unsigned int)size[i] : 1;
+    }
+};
+#endif
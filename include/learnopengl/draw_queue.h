@@ -0,0 +1,182 @@
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+
+#include <glad/glad.h>
+#include <learnopengl/render_state.h>
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// a 64-bit sort key, most significant field first, so that sorting draws by
+// key groups them by pass, then program, then textures, then vertex array,
+// and only then orders them by depth:
+//   bits 60-63  pass            (0-15, e.g. opaque before transparent)
+//   bits 48-59  program         (0-4095, an index, not the GL name)
+//   bits 32-47  texture set     (0-65535)
+//   bits 20-31  vertex array    (0-4095)
+//   bits  0-19  depth           (0..1 quantized; pass 1 - depth for back to front)
+// the indices are whatever the caller numbers its programs, materials and
+// meshes with; larger values are masked to their field.
+struct DrawKey
+{
+    static uint64_t make(unsigned int pass, unsigned int program, unsigned int textureSet, unsigned int vertexArray,
+                         float depth)
+    {
+        if (depth < 0.0f)
+            depth = 0.0f;
+        if (depth > 1.0f)
+            depth = 1.0f;
+        uint64_t quantized = (uint64_t)(depth * 0xfffff);
+        return (uint64_t)(pass & 0xf) << 60 | (uint64_t)(program & 0xfff) << 48 |
+               (uint64_t)(textureSet & 0xffff) << 32 | (uint64_t)(vertexArray & 0xfff) << 20 | quantized;
+    }
+};
+
+// everything one glDrawElements / glDrawArrays needs. param, if paramLocation
+// is not -1, is set as a vec4 uniform of the program right before the draw
+struct DrawCommand
+{
+    static const int maxTextures = 4;
+
+    uint64_t key = 0;
+    unsigned int program = 0;
+    unsigned int vertexArray = 0;
+    unsigned int textures[maxTextures] = {0, 0, 0, 0}; // GL_TEXTURE_2D on units 0..3, 0 = leave the unit alone
+    GLenum mode = GL_TRIANGLES;
+    GLsizei count = 0;
+    GLenum indexType = GL_UNSIGNED_INT; // 0 for glDrawArrays
+    size_t first = 0;                   // byte offset into the element buffer, or first vertex
+    int paramLocation = -1;
+    float param[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// draws recorded by one thread. it makes no GL calls, so every worker can
+// fill its own while the GL thread does something else
+class CommandBuffer
+{
+public:
+    void draw(const DrawCommand &command) { commands.push_back(command); }
+    void clear() { commands.clear(); }
+    size_t size() const { return commands.size(); }
+    void reserve(size_t count) { commands.reserve(count); }
+    const std::vector<DrawCommand> &data() const { return commands; }
+
+private:
+    std::vector<DrawCommand> commands;
+};
+
+// collects the command buffers of a frame, sorts all their draws by key and
+// issues them through a RenderState, so that draws sharing a program,
+// textures or vertex array follow each other and the state in between is
+// filtered out. the order the threads recorded in doesn't matter; draws with
+// equal keys keep their order within a buffer.
+//
+//   DrawQueue queue(threads);
+//   // on each worker t:  queue.buffer(t).draw(command);
+//   // after joining, on the GL thread:
+//   queue.submit(state);   // also clears the buffers
+class DrawQueue
+{
+public:
+    explicit DrawQueue(size_t threads = 1)
+    {
+        for (size_t i = 0; i < (threads ? threads : 1); ++i)
+            buffers.emplace_back(new CommandBuffer);
+    }
+
+    size_t threads() const { return buffers.size(); }
+    // the buffer a thread records into; only that thread may touch it
+    CommandBuffer &buffer(size_t thread = 0) { return *buffers[thread]; }
+
+    // sort and issue every recorded draw, then clear the buffers. returns the
+    // number of draws
+    size_t submit(RenderState &state)
+    {
+        sort();
+        for (const Entry &entry : sorted)
+            issue(state, *entry.command);
+        size_t count = sorted.size();
+        for (auto &buffer : buffers)
+            buffer->clear();
+        sorted.clear();
+        return count;
+    }
+    // the draws in the order submit() will issue them, for inspection; valid
+    // until the buffers change
+    std::vector<const DrawCommand *> order()
+    {
+        sort();
+        std::vector<const DrawCommand *> commands;
+        commands.reserve(sorted.size());
+        for (const Entry &entry : sorted)
+            commands.push_back(entry.command);
+        return commands;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        const DrawCommand *command;
+    };
+    std::vector<std::unique_ptr<CommandBuffer>> buffers;
+    std::vector<Entry> sorted, scratch;
+
+    // merge the buffers and LSD radix sort the (key, command) pairs a byte at
+    // a time; a byte that is the same in every key is skipped. moving the
+    // small pairs is much cheaper than moving the commands themselves
+    void sort()
+    {
+        sorted.clear();
+        for (auto &buffer : buffers)
+        {
+            for (const DrawCommand &command : buffer->data())
+                sorted.push_back({command.key, &command});
+        }
+        if (sorted.size() < 2)
+            return;
+        scratch.resize(sorted.size());
+        size_t counts[8][256] = {};
+        for (const Entry &entry : sorted)
+        {
+            for (int pass = 0; pass < 8; ++pass)
+                ++counts[pass][(entry.key >> (pass * 8)) & 0xff];
+        }
+        for (int pass = 0; pass < 8; ++pass)
+        {
+            size_t *count = counts[pass];
+            int shift = pass * 8;
+            if (count[(sorted[0].key >> shift) & 0xff] == sorted.size())
+                continue;
+            size_t offset = 0;
+            for (int i = 0; i < 256; ++i)
+            {
+                size_t n = count[i];
+                count[i] = offset;
+                offset += n;
+            }
+            for (const Entry &entry : sorted)
+                scratch[count[(entry.key >> shift) & 0xff]++] = entry;
+            sorted.swap(scratch);
+        }
+    }
+    static void issue(RenderState &state, const DrawCommand &command)
+    {
+        state.useProgram(command.program);
+        for (int unit = 0; unit < DrawCommand::maxTextures; ++unit)
+        {
+            if (command.textures[unit])
+                state.bindTexture(unit, GL_TEXTURE_2D, command.textures[unit]);
+        }
+        state.bindVertexArray(command.vertexArray);
+        if (command.paramLocation >= 0)
+            glUniform4fv(command.paramLocation, 1, command.param);
+        if (command.indexType)
+            glDrawElements(command.mode, command.count, command.indexType, (void *)command.first);
+        else
+            glDrawArrays(command.mode, (GLint)command.first, command.count);
+    }
+};
+#endif
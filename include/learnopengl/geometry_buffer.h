@@ -0,0 +1,275 @@
+#ifndef GEOMETRY_BUFFER_H
+#define GEOMETRY_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <map>
+#include <iterator>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+// first-fit allocator over a range of [0, capacity) units with a free list
+// kept sorted by offset, so freeing merges a block with its free neighbours
+// and the range doesn't fragment into pieces too small to reuse
+class RangeAllocator
+{
+public:
+    static const size_t invalid = (size_t)-1;
+
+    explicit RangeAllocator(size_t capacity = 0)
+        : capacity(capacity)
+    {
+        if (capacity)
+            freeBlocks[0] = capacity;
+    }
+    // the offset of count free units, or invalid if no free block is big enough
+    size_t allocate(size_t count)
+    {
+        if (count == 0)
+            return invalid;
+        for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+        {
+            if (it->second < count)
+                continue;
+            size_t offset = it->first, remaining = it->second - count;
+            freeBlocks.erase(it);
+            if (remaining)
+                freeBlocks[offset + count] = remaining;
+            usedUnits += count;
+            return offset;
+        }
+        return invalid;
+    }
+    void free(size_t offset, size_t count)
+    {
+        if (offset == invalid || count == 0)
+            return;
+        usedUnits -= count;
+        auto next = freeBlocks.lower_bound(offset);
+        if (next != freeBlocks.begin())
+        {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset)
+            {
+                offset = previous->first;
+                count += previous->second;
+                freeBlocks.erase(previous);
+            }
+        }
+        if (next != freeBlocks.end() && offset + count == next->first)
+        {
+            count += next->second;
+            freeBlocks.erase(next);
+        }
+        freeBlocks[offset] = count;
+    }
+    size_t used() const { return usedUnits; }
+    size_t size() const { return capacity; }
+    size_t freeBlockCount() const { return freeBlocks.size(); }
+
+private:
+    size_t capacity;
+    size_t usedUnits = 0;
+    std::map<size_t, size_t> freeBlocks; // offset -> length
+};
+
+// where a mesh lives in a GeometryBuffer, in vertices and indices
+struct MeshRange
+{
+    size_t firstVertex = RangeAllocator::invalid;
+    size_t vertexCount = 0;
+    size_t firstIndex = RangeAllocator::invalid;
+    size_t indexCount = 0;
+
+    bool valid() const { return firstVertex != RangeAllocator::invalid && firstIndex != RangeAllocator::invalid; }
+};
+
+// the vertices of many meshes in one vertex buffer and their indices in one
+// index buffer, behind one VAO, instead of a VBO / EBO / VAO per mesh. every
+// mesh has the same vertex layout; its indices stay relative to its own
+// first vertex, which the draw adds as the base vertex. fixed capacity: add()
+// fails (an invalid range) when either buffer is full.
+//
+//   GeometryBuffer geometry(5 * sizeof(float), 1 << 20, 3 << 20);
+//   geometry.attribute(0, 3, GL_FLOAT, 0);
+//   geometry.attribute(1, 2, GL_FLOAT, 3 * sizeof(float));
+//   MeshRange cube = geometry.add(vertices, 24, indices, 36);
+class GeometryBuffer
+{
+public:
+    GeometryBuffer(size_t vertexStride, size_t maxVertices, size_t maxIndices)
+        : stride(vertexStride), vertices(maxVertices), indices(maxIndices)
+    {
+        int previous = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &indexBuffer);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, maxVertices * vertexStride, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, maxIndices * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+        glBindVertexArray((unsigned int)previous);
+    }
+    ~GeometryBuffer()
+    {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+    }
+    GeometryBuffer(const GeometryBuffer &) = delete;
+    GeometryBuffer &operator=(const GeometryBuffer &) = delete;
+
+    // a float vertex attribute at offset bytes into each vertex
+    void attribute(unsigned int location, int size, GLenum type, size_t offset, bool normalized = false)
+    {
+        int previous = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glVertexAttribPointer(location, size, type, normalized ? GL_TRUE : GL_FALSE, (GLsizei)stride, (void *)offset);
+        glEnableVertexAttribArray(location);
+        glBindVertexArray((unsigned int)previous);
+    }
+    // copy a mesh in; indices are 32-bit and count from the mesh's first vertex
+    MeshRange add(const void *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
+    {
+        MeshRange range;
+        range.firstVertex = vertices.allocate(vertexCount);
+        range.firstIndex = indices.allocate(indexCount);
+        if (!range.valid())
+        {
+            std::cout << "ERROR::GEOMETRY_BUFFER::OUT_OF_SPACE: " << vertexCount << " vertices, " << indexCount
+                      << " indices" << std::endl;
+            vertices.free(range.firstVertex, vertexCount);
+            indices.free(range.firstIndex, indexCount);
+            return MeshRange();
+        }
+        range.vertexCount = vertexCount;
+        range.indexCount = indexCount;
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, range.firstVertex * stride, vertexCount * stride, vertexData);
+        // the element buffer binding is VAO state, so go through the copy target
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int),
+                        indexData);
+        return range;
+    }
+    // give a mesh's space back; the range is invalid afterwards
+    void remove(MeshRange &range)
+    {
+        if (!range.valid())
+            return;
+        vertices.free(range.firstVertex, range.vertexCount);
+        indices.free(range.firstIndex, range.indexCount);
+        range = MeshRange();
+    }
+
+    unsigned int vertexArray() const { return vao; }
+    const RangeAllocator &vertexSpace() const { return vertices; }
+    const RangeAllocator &indexSpace() const { return indices; }
+
+private:
+    size_t stride;
+    unsigned int vao = 0, vertexBuffer = 0, indexBuffer = 0;
+    RangeAllocator vertices, indices;
+};
+
+// the draws of one pass over a GeometryBuffer, built on the CPU as
+// DrawElementsIndirectCommands and submitted with a single
+// glMultiDrawElementsIndirect (GL 4.3, or GL_ARB_multi_draw_indirect). where
+// that is missing each command is drawn on its own, with
+// glDrawElementsIndirect or else glDrawElementsInstancedBaseVertex, so the
+// same code runs on GL 3.3 and macOS.
+//
+// baseInstance offsets the instance attributes (divisor 1) of a draw, which
+// gives every mesh in the pass its own per-draw data; it needs GL 4.2 (or
+// GL_ARB_base_instance) and is ignored without it.
+class IndirectDrawBatch
+{
+public:
+    struct Command
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    IndirectDrawBatch()
+    {
+        if (GLAD_GL_ARB_draw_indirect)
+            glGenBuffers(1, &indirectBuffer);
+    }
+    ~IndirectDrawBatch()
+    {
+        if (indirectBuffer)
+            glDeleteBuffers(1, &indirectBuffer);
+    }
+    IndirectDrawBatch(const IndirectDrawBatch &) = delete;
+    IndirectDrawBatch &operator=(const IndirectDrawBatch &) = delete;
+
+    static bool multiDrawSupported()
+    {
+        return GLAD_GL_ARB_multi_draw_indirect != 0;
+    }
+
+    void draw(const MeshRange &mesh, unsigned int instanceCount = 1, unsigned int baseInstance = 0)
+    {
+        if (!mesh.valid())
+            return;
+        commands.push_back({(GLuint)mesh.indexCount, instanceCount, (GLuint)mesh.firstIndex, (GLint)mesh.firstVertex,
+                            GLAD_GL_ARB_base_instance ? baseInstance : 0u});
+    }
+    void clear() { commands.clear(); }
+    size_t size() const { return commands.size(); }
+
+    // draw everything with the geometry's VAO bound and clear the batch.
+    // returns the number of draw calls it took
+    size_t submit(const GeometryBuffer &geometry, GLenum mode = GL_TRIANGLES)
+    {
+        if (commands.empty())
+            return 0;
+        glBindVertexArray(geometry.vertexArray());
+        size_t calls = 0;
+        if (indirectBuffer)
+        {
+            // orphan last frame's commands instead of waiting for them to be read
+            GLsizeiptr bytes = (GLsizeiptr)(commands.size() * sizeof(Command));
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+            if (multiDrawSupported())
+            {
+                glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void *)0, (GLsizei)commands.size(), 0);
+                calls = 1;
+            }
+            else
+            {
+                for (size_t i = 0; i < commands.size(); ++i)
+                    glDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void *)(i * sizeof(Command)));
+                calls = commands.size();
+            }
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else
+        {
+            for (const Command &c : commands)
+                glDrawElementsInstancedBaseVertex(mode, (GLsizei)c.count, GL_UNSIGNED_INT,
+                                                  (void *)(c.firstIndex * sizeof(unsigned int)),
+                                                  (GLsizei)c.instanceCount, c.baseVertex);
+            calls = commands.size();
+        }
+        commands.clear();
+        return calls;
+    }
+
+private:
+    unsigned int indirectBuffer = 0;
+    std::vector<Command> commands;
+};
+#endif
@@ -0,0 +1,127 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstring>
+
+// what every copy of an instanced mesh gets on its own. transform is a
+// column-major mat4 like glUniformMatrix4fv takes; layer picks a layer of a
+// sampler2DArray
+struct Instance
+{
+    float transform[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    float color[4] = {1, 1, 1, 1};
+    float layer = 0.0f;
+
+    // a uniform scale followed by a translation
+    void place(float x, float y, float z, float scale)
+    {
+        static const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        memcpy(transform, identity, sizeof(transform));
+        transform[0] = transform[5] = transform[10] = scale;
+        transform[12] = x;
+        transform[13] = y;
+        transform[14] = z;
+    }
+};
+
+// per-instance attributes in their own vertex buffer: attached to a VAO, the
+// mesh's vertices advance per vertex and these per instance
+// (glVertexAttribDivisor 1), so one glDrawElementsInstanced draws every
+// instance. in the vertex shader, starting at the location given to the
+// constructor:
+//   layout (location = N)     in mat4 aTransform;  // takes N .. N+3
+//   layout (location = N + 4) in vec4 aColor;
+//   layout (location = N + 5) in float aLayer;
+//
+//   InstanceBuffer instances(3);
+//   instances.attach(VAO);
+//   instances.update(data, count);  // whenever they move
+//   glBindVertexArray(VAO);
+//   instances.drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+class InstanceBuffer
+{
+public:
+    static const unsigned int locationCount = 6;
+
+    explicit InstanceBuffer(unsigned int firstLocation = 3, size_t capacity = 0)
+        : firstLocation(firstLocation)
+    {
+        glGenBuffers(1, &buffer);
+        if (capacity)
+            reserve(capacity);
+    }
+    ~InstanceBuffer()
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+    InstanceBuffer(const InstanceBuffer &) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+    // add the instance attributes to a VAO; the mesh's own attributes and
+    // element buffer stay as they are. several VAOs can share one buffer
+    void attach(unsigned int vao)
+    {
+        int previous = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        const GLsizei stride = sizeof(Instance);
+        for (unsigned int column = 0; column < 4; ++column)
+            pointer(firstLocation + column, 4, stride, offsetof(Instance, transform) + column * 4 * sizeof(float));
+        pointer(firstLocation + 4, 4, stride, offsetof(Instance, color));
+        pointer(firstLocation + 5, 1, stride, offsetof(Instance, layer));
+        glBindVertexArray((unsigned int)previous);
+    }
+    // replace the instances. the old storage is orphaned first, so a draw
+    // still reading last frame's instances doesn't stall this upload
+    void update(const Instance *instances, size_t count)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        if (count > capacity)
+            capacity = count;
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), NULL, GL_STREAM_DRAW);
+        if (count)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Instance), instances);
+        instanceCount = count;
+    }
+    void reserve(size_t count)
+    {
+        if (count <= capacity)
+            return;
+        capacity = count;
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), NULL, GL_STREAM_DRAW);
+        instanceCount = 0;
+    }
+    // draw the mesh of the bound VAO once per instance
+    void drawElements(GLenum mode, GLsizei count, GLenum type, size_t offset) const
+    {
+        if (instanceCount)
+            glDrawElementsInstanced(mode, count, type, (void *)offset, (GLsizei)instanceCount);
+    }
+    void drawArrays(GLenum mode, GLint first, GLsizei count) const
+    {
+        if (instanceCount)
+            glDrawArraysInstanced(mode, first, count, (GLsizei)instanceCount);
+    }
+
+    unsigned int id() const { return buffer; }
+    size_t size() const { return instanceCount; }
+
+private:
+    unsigned int buffer = 0;
+    unsigned int firstLocation;
+    size_t capacity = 0;
+    size_t instanceCount = 0;
+
+    static void pointer(unsigned int location, int size, GLsizei stride, size_t offset)
+    {
+        glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride, (void *)offset);
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+};
+#endif
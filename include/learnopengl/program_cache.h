@@ -0,0 +1,139 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <initializer_list>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+
+// on-disk cache of linked program binaries (GL_ARB_get_program_binary).
+// a program is stored under a hash of its shader sources and the driver's
+// vendor, renderer and version strings, so editing a shader or updating the
+// driver simply misses. if the driver rejects a cached binary anyway, the
+// caller compiles from source as if it had missed.
+// the cache is off until a directory is set
+class ProgramCache
+{
+public:
+    static void setDirectory(const std::string &path)
+    {
+        directory() = path;
+        if (!path.empty())
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(path, ec);
+        }
+    }
+    // cache on, and supported by the current context
+    static bool enabled()
+    {
+        if (directory().empty() || !GLAD_GL_ARB_get_program_binary)
+            return false;
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+    // key for a program built from these sources on the current driver
+    static uint64_t key(std::initializer_list<std::string_view> sources)
+    {
+        uint64_t h = 14695981039346656037ull;
+        const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+        for (GLenum s : strings)
+        {
+            const char *value = (const char *)glGetString(s);
+            h = hash(value ? value : "", value ? strlen(value) + 1 : 1, h);
+        }
+        for (std::string_view source : sources)
+        {
+            h = hash(source.data(), source.size(), h);
+            h = hash("", 1, h); // keep ("ab", "c") apart from ("a", "bc")
+        }
+        return h;
+    }
+    // set program to the cached binary for key; false (program untouched) if
+    // there is none or the driver won't take it
+    static bool load(unsigned int program, uint64_t key)
+    {
+        std::ifstream file(path(key), std::ios::binary);
+        if (!file)
+            return false;
+        Header header;
+        if (!file.read((char *)&header, sizeof(header)) || header.magic != Magic || header.key != key ||
+            header.length == 0 || header.length > MaxLength)
+            return false;
+        std::vector<char> binary(header.length);
+        if (!file.read(binary.data(), binary.size()))
+            return false;
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        int success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success != 0;
+    }
+    // write a linked program out under key. programs should be linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    static void store(unsigned int program, uint64_t key)
+    {
+        int length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        Header header;
+        header.magic = Magic;
+        header.key = key;
+        glGetProgramBinary(program, length, &length, &header.format, binary.data());
+        header.length = (uint32_t)length;
+        // write beside the final name and rename, so that a concurrent run
+        // never reads half a file
+        std::string final = path(key), temp = final + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            if (!file.write((const char *)&header, sizeof(header)) || !file.write(binary.data(), length))
+                return;
+        }
+        std::error_code ec;
+        std::filesystem::rename(temp, final, ec);
+        if (ec)
+            std::filesystem::remove(temp, ec);
+    }
+
+private:
+    static const uint32_t Magic = 0x42504c47; // "GLPB"
+    static const uint32_t MaxLength = 1u << 28;
+    struct Header
+    {
+        uint32_t magic;
+        GLenum format;
+        uint64_t key;
+        uint32_t length;
+        uint32_t reserved = 0;
+    };
+
+    static std::string &directory()
+    {
+        static std::string dir;
+        return dir;
+    }
+    static std::string path(uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return directory() + "/" + name;
+    }
+    // FNV-1a, 64 bit
+    static uint64_t hash(const void *data, size_t size, uint64_t h)
+    {
+        const unsigned char *p = (const unsigned char *)data;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ p[i]) * 1099511628211ull;
+        return h;
+    }
+};
+#endif
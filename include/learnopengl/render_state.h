@@ -0,0 +1,256 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// a shadow copy of the GL state a render loop keeps setting: the program,
+// the vertex array, the buffer of each target, the texture of each unit and
+// the blend / depth / cull state. a call that would set what is already set
+// doesn't reach GL, so a frame that binds the same things as the last one
+// costs a few compares instead of driver calls.
+//
+// the shadow only knows about changes made through it. after code that goes
+// to GL directly (a library, glDelete* of something that was bound, a
+// Shader::adopt), call invalidate() and the next call of each kind is
+// issued again. everything starts out unknown, so the first calls always
+// reach GL.
+//
+// issued() and filtered() count the calls that did and didn't reach GL
+// since the last resetCounters().
+class RenderState
+{
+public:
+    static const int maxTextureUnits = 32;
+
+    RenderState()
+    {
+        invalidate();
+    }
+
+    // forget everything; the next call of each kind is issued
+    void invalidate()
+    {
+        program = unknown;
+        vertexArray = unknown;
+        for (unsigned int &buffer : buffers)
+            buffer = unknown;
+        activeUnit = unknown;
+        for (auto &unit : textures)
+        {
+            for (unsigned int &texture : unit)
+                texture = unknown;
+        }
+        for (int8_t &cap : caps)
+            cap = -1;
+        blendSrcRGB = blendDstRGB = blendSrcAlpha = blendDstAlpha = unknown;
+        blendEquationRGB = blendEquationAlpha = unknown;
+        depthFuncValue = unknown;
+        depthMaskValue = -1;
+        cullFaceMode = unknown;
+    }
+
+    void useProgram(unsigned int id)
+    {
+        if (filter(program == id))
+            return;
+        program = id;
+        glUseProgram(id);
+    }
+    void bindVertexArray(unsigned int id)
+    {
+        if (filter(vertexArray == id))
+            return;
+        vertexArray = id;
+        glBindVertexArray(id);
+        // the element buffer binding belongs to the vertex array
+        buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+    }
+    // targets other than the common ones below are always issued
+    void bindBuffer(GLenum target, unsigned int id)
+    {
+        int i = bufferIndex(target);
+        if (i >= 0 && filter(buffers[i] == id))
+            return;
+        if (i < 0)
+            ++issuedCalls;
+        else
+            buffers[i] = id;
+        glBindBuffer(target, id);
+    }
+    void activeTexture(unsigned int unit)
+    {
+        if (filter(activeUnit == unit))
+            return;
+        activeUnit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    // bind a texture to a unit (0, 1, ... rather than GL_TEXTURE0 + n); only
+    // makes the unit active when the binding actually changes
+    void bindTexture(unsigned int unit, GLenum target, unsigned int id)
+    {
+        int i = textureIndex(target);
+        if (unit < (unsigned int)maxTextureUnits && i >= 0)
+        {
+            if (filter(textures[unit][i] == id))
+                return;
+            textures[unit][i] = id;
+        }
+        else
+            ++issuedCalls;
+        activeTexture(unit);
+        glBindTexture(target, id);
+    }
+    // glEnable / glDisable; capabilities other than the ones below are
+    // always issued
+    void enable(GLenum cap) { setEnabled(cap, true); }
+    void disable(GLenum cap) { setEnabled(cap, false); }
+    void setEnabled(GLenum cap, bool on)
+    {
+        int i = capIndex(cap);
+        if (i >= 0 && filter(caps[i] == (on ? 1 : 0)))
+            return;
+        if (i < 0)
+            ++issuedCalls;
+        else
+            caps[i] = on ? 1 : 0;
+        if (on)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+    void blendFunc(GLenum src, GLenum dst) { blendFuncSeparate(src, dst, src, dst); }
+    void blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+    {
+        if (filter(blendSrcRGB == srcRGB && blendDstRGB == dstRGB && blendSrcAlpha == srcAlpha && blendDstAlpha == dstAlpha))
+            return;
+        blendSrcRGB = srcRGB;
+        blendDstRGB = dstRGB;
+        blendSrcAlpha = srcAlpha;
+        blendDstAlpha = dstAlpha;
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+    }
+    void blendEquation(GLenum mode)
+    {
+        if (filter(blendEquationRGB == mode && blendEquationAlpha == mode))
+            return;
+        blendEquationRGB = blendEquationAlpha = mode;
+        glBlendEquation(mode);
+    }
+    void depthFunc(GLenum func)
+    {
+        if (filter(depthFuncValue == func))
+            return;
+        depthFuncValue = func;
+        glDepthFunc(func);
+    }
+    void depthMask(bool write)
+    {
+        if (filter(depthMaskValue == (write ? 1 : 0)))
+            return;
+        depthMaskValue = write ? 1 : 0;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+    void cullFace(GLenum mode)
+    {
+        if (filter(cullFaceMode == mode))
+            return;
+        cullFaceMode = mode;
+        glCullFace(mode);
+    }
+
+    unsigned long long issued() const { return issuedCalls; }
+    unsigned long long filtered() const { return filteredCalls; }
+    void resetCounters()
+    {
+        issuedCalls = 0;
+        filteredCalls = 0;
+    }
+
+private:
+    static const unsigned int unknown = 0xffffffffu;
+    static const int bufferTargets = 6;
+    static const int textureTargets = 5;
+    static const int capCount = 6;
+
+    unsigned int program;
+    unsigned int vertexArray;
+    unsigned int buffers[bufferTargets];
+    unsigned int activeUnit;
+    unsigned int textures[maxTextureUnits][textureTargets];
+    int8_t caps[capCount]; // -1 unknown, 0 disabled, 1 enabled
+    unsigned int blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha;
+    unsigned int blendEquationRGB, blendEquationAlpha;
+    unsigned int depthFuncValue;
+    int8_t depthMaskValue;
+    unsigned int cullFaceMode;
+    unsigned long long issuedCalls = 0;
+    unsigned long long filteredCalls = 0;
+
+    // counts the call one way or the other; true if it can be skipped
+    bool filter(bool same)
+    {
+        if (same)
+            ++filteredCalls;
+        else
+            ++issuedCalls;
+        return same;
+    }
+    static int bufferIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:
+            return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return 1;
+        case GL_UNIFORM_BUFFER:
+            return 2;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return 3;
+        case GL_PIXEL_PACK_BUFFER:
+            return 4;
+        case GL_COPY_WRITE_BUFFER:
+            return 5;
+        }
+        return -1;
+    }
+    static int textureIndex(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D:
+            return 0;
+        case GL_TEXTURE_CUBE_MAP:
+            return 1;
+        case GL_TEXTURE_2D_ARRAY:
+            return 2;
+        case GL_TEXTURE_3D:
+            return 3;
+        case GL_TEXTURE_BUFFER:
+            return 4;
+        }
+        return -1;
+    }
+    static int capIndex(GLenum cap)
+    {
+        switch (cap)
+        {
+        case GL_BLEND:
+            return 0;
+        case GL_DEPTH_TEST:
+            return 1;
+        case GL_CULL_FACE:
+            return 2;
+        case GL_STENCIL_TEST:
+            return 3;
+        case GL_SCISSOR_TEST:
+            return 4;
+        case GL_FRAMEBUFFER_SRGB:
+            return 5;
+        }
+        return -1;
+    }
+};
+#endif
@@ -0,0 +1,200 @@
+#ifndef SHADER_ARCHIVE_H
+#define SHADER_ARCHIVE_H
+
+#include <learnopengl/shader_s.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// every shader of a program in one file, so startup opens and reads a single
+// file instead of two per Shader. the file is mapped (or, where that fails,
+// read with one fread) and the sources are handed to Shader::fromSource
+// straight out of the mapping. CMake packs resources/shader into
+// bin/shaders.glsa at configure time; pack() does the same from code.
+//
+// the format is plain text, one entry per file:
+//   #shader-archive 1
+//   @<name> <size in bytes>\n<source>\n
+class ShaderArchive
+{
+public:
+    explicit ShaderArchive(const std::string &path)
+    {
+        if (!open(path))
+        {
+            std::cout << "ERROR::SHADER::ARCHIVE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return;
+        }
+        if (!parse())
+        {
+            std::cout << "ERROR::SHADER::ARCHIVE_CORRUPT: " << path << std::endl;
+            entries.clear();
+        }
+    }
+    ~ShaderArchive()
+    {
+        close();
+    }
+    ShaderArchive(const ShaderArchive &) = delete;
+    ShaderArchive &operator=(const ShaderArchive &) = delete;
+
+    bool valid() const { return !entries.empty(); }
+    bool contains(const std::string &name) const { return entries.count(name) != 0; }
+    // the named source, valid as long as the archive; empty if it isn't there
+    std::string_view source(const std::string &name) const
+    {
+        auto it = entries.find(name);
+        return it == entries.end() ? std::string_view() : it->second;
+    }
+    Shader shader(const std::string &vertexName, const std::string &fragmentName) const
+    {
+        const std::string *names[] = {&vertexName, &fragmentName};
+        for (const std::string *name : names)
+        {
+            if (!contains(*name))
+                std::cout << "ERROR::SHADER::NOT_IN_ARCHIVE: " << *name << std::endl;
+        }
+        return Shader::fromSource(source(vertexName), source(fragmentName));
+    }
+    // write the files at paths into an archive at path, each under its file name
+    static bool pack(const std::vector<std::string> &paths, const std::string &path)
+    {
+        std::string out = "#shader-archive 1\n";
+        for (const std::string &file : paths)
+        {
+            std::string code;
+            if (!Shader::readFile(file.c_str(), code))
+                return false;
+            size_t slash = file.find_last_of("/\\");
+            out += "@" + file.substr(slash == std::string::npos ? 0 : slash + 1) + " " + std::to_string(code.size()) + "\n";
+            out += code;
+            out += "\n";
+        }
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+        return fclose(f) == 0 && ok;
+    }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::unique_ptr<std::string> owned; // the file, when it couldn't be mapped
+#if defined(_WIN32)
+    HANDLE mapping = NULL;
+#endif
+    std::unordered_map<std::string, std::string_view> entries;
+
+    bool open(const std::string &path)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        LARGE_INTEGER length;
+        if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &length) && length.QuadPart > 0)
+        {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping)
+            {
+                data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (data)
+                {
+                    size = (size_t)length.QuadPart;
+                    mapped = true;
+                }
+                else
+                    CloseHandle(mapping);
+            }
+        }
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file); // the mapping keeps the file open
+        if (mapped)
+            return true;
+#elif defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+            {
+                void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    data = (const char *)p;
+                    size = (size_t)st.st_size;
+                    mapped = true;
+                }
+            }
+            ::close(fd); // the mapping keeps the file open
+            if (mapped)
+                return true;
+        }
+#endif
+        // no mapping: one read into memory of our own
+        std::string *buffer = new std::string;
+        if (!Shader::readFile(path.c_str(), *buffer) || buffer->empty())
+        {
+            delete buffer;
+            return false;
+        }
+        owned.reset(buffer);
+        data = owned->data();
+        size = owned->size();
+        return true;
+    }
+    void close()
+    {
+        if (!mapped)
+            return;
+#if defined(_WIN32)
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+#elif defined(__unix__) || defined(__APPLE__)
+        munmap((void *)data, size);
+#endif
+    }
+    bool parse()
+    {
+        std::string_view text(data, size);
+        const std::string_view magic = "#shader-archive 1\n";
+        if (text.substr(0, magic.size()) != magic)
+            return false;
+        size_t at = magic.size();
+        while (at < text.size())
+        {
+            size_t space = text.find(' ', at), newline = text.find('\n', at);
+            if (text[at] != '@' || space == std::string_view::npos || newline == std::string_view::npos || space > newline)
+                return false;
+            std::string name(text.substr(at + 1, space - at - 1));
+            char *end = nullptr;
+            unsigned long long length = strtoull(text.data() + space + 1, &end, 10);
+            if (end != text.data() + newline || length > text.size() - newline - 1)
+                return false;
+            entries[name] = text.substr(newline + 1, (size_t)length);
+            at = newline + 1 + (size_t)length;
+            if (at < text.size() && text[at] == '\n')
+                ++at;
+        }
+        return true;
+    }
+};
+#endif
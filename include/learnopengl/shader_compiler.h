@@ -0,0 +1,268 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_s.h>
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+// compiles many programs at once instead of one after the other. submit()
+// starts a program and returns a future for its Shader; poll(), called from
+// the GL thread (e.g. once per frame while loading), hands finished programs
+// to their futures. so don't wait() on a future without polling.
+//
+// with GL_KHR_parallel_shader_compile the driver compiles on its own threads
+// and poll() asks GL_COMPLETION_STATUS_KHR, which never blocks. without it,
+// a worker thread compiles on a second context that shares objects with the
+// GL thread's, if the constructor is given a function that makes one current
+// (e.g. glfwMakeContextCurrent on a hidden window created with the main
+// window as its share). with neither, poll() compiles synchronously.
+// programs found in the ProgramCache are ready straight away
+class ShaderCompiler
+{
+public:
+    explicit ShaderCompiler(std::function<bool()> makeSharedContextCurrent = nullptr)
+    {
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            mode = Mode::Parallel;
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // as many as the driver wants
+        }
+        else if (makeSharedContextCurrent)
+        {
+            mode = Mode::Worker;
+            worker = std::thread(&ShaderCompiler::workerMain, this, makeSharedContextCurrent);
+        }
+    }
+    ~ShaderCompiler()
+    {
+        if (worker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+        // programs nobody polled for
+        for (auto &job : pending)
+            discard(*job);
+        for (auto &job : compiled)
+            discard(*job);
+    }
+    ShaderCompiler(const ShaderCompiler &) = delete;
+    ShaderCompiler &operator=(const ShaderCompiler &) = delete;
+
+    std::future<Shader> submit(const char *vertexPath, const char *fragmentPath)
+    {
+        std::string vertexCode, fragmentCode;
+        Shader::readFile(vertexPath, vertexCode);
+        Shader::readFile(fragmentPath, fragmentCode);
+        return submitSource(std::move(vertexCode), std::move(fragmentCode));
+    }
+    std::future<Shader> submitSource(std::string vertexCode, std::string fragmentCode)
+    {
+        std::unique_ptr<Job> job(new Job);
+        job->vertexCode = std::move(vertexCode);
+        job->fragmentCode = std::move(fragmentCode);
+        std::future<Shader> future = job->promise.get_future();
+        if (mode == Mode::Worker)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued.push_back(std::move(job));
+                ++outstanding;
+            }
+            wake.notify_one();
+        }
+        else if (mode == Mode::Parallel && start(*job))
+            ready(*job); // cache hit
+        else
+            pending.push_back(std::move(job));
+        return future;
+    }
+    // fulfil the futures of finished programs; returns how many are still
+    // compiling
+    size_t poll()
+    {
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            Job &job = **it;
+            if (mode == Mode::Parallel)
+            {
+                int done = 0;
+                glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &done);
+                if (!done)
+                {
+                    ++it;
+                    continue;
+                }
+                complete(job);
+            }
+            else if (!start(job))
+                complete(job);
+            ready(job);
+            it = pending.erase(it);
+        }
+        if (mode != Mode::Worker)
+            return pending.size();
+
+        std::deque<std::unique_ptr<Job>> done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.swap(compiled);
+            outstanding -= done.size();
+            if (workerFailed)
+            {
+                // no shared context after all: compile here from now on
+                mode = Mode::Synchronous;
+                for (auto &job : queued)
+                    pending.push_back(std::move(job));
+                outstanding -= queued.size();
+                queued.clear();
+            }
+        }
+        for (auto &job : done)
+            ready(*job);
+        return mode == Mode::Worker ? outstanding : poll();
+    }
+    // block until every submitted program is handed out
+    void finish()
+    {
+        while (poll() > 0)
+            std::this_thread::yield();
+    }
+
+private:
+    enum class Mode
+    {
+        Synchronous,
+        Parallel,
+        Worker
+    };
+    struct Job
+    {
+        std::string vertexCode, fragmentCode;
+        std::promise<Shader> promise;
+        unsigned int vertex = 0, fragment = 0, program = 0;
+        bool useCache = false;
+        uint64_t cacheKey = 0;
+        ProgramBuildInfo info;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    Mode mode = Mode::Synchronous;
+    std::deque<std::unique_ptr<Job>> pending; // GL thread only
+
+    // worker mode
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<Job>> queued, compiled;
+    size_t outstanding = 0;
+    bool stopping = false, workerFailed = false;
+
+    // create the program and either load it from the cache (true) or issue
+    // the compiles and the link without waiting for them (false)
+    static bool start(Job &job)
+    {
+        job.start = std::chrono::steady_clock::now();
+        job.program = glCreateProgram();
+        job.useCache = ProgramCache::enabled();
+        if (job.useCache)
+        {
+            job.cacheKey = ProgramCache::key({job.vertexCode, job.fragmentCode});
+            if (ProgramCache::load(job.program, job.cacheKey))
+            {
+                job.info.cacheHit = true;
+                job.info.milliseconds = elapsedMs(job.start);
+                return true;
+            }
+        }
+        const char *vShaderCode = job.vertexCode.c_str();
+        const char *fShaderCode = job.fragmentCode.c_str();
+        job.vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(job.vertex, 1, &vShaderCode, NULL);
+        glCompileShader(job.vertex);
+        job.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(job.fragment, 1, &fShaderCode, NULL);
+        glCompileShader(job.fragment);
+        glAttachShader(job.program, job.vertex);
+        glAttachShader(job.program, job.fragment);
+        if (job.useCache)
+            glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(job.program);
+        return false;
+    }
+    // check the results of start(); blocks unless the program has completed
+    static void complete(Job &job)
+    {
+        Shader::checkCompileErrors(job.vertex, "VERTEX");
+        Shader::checkCompileErrors(job.fragment, "FRAGMENT");
+        bool linked = Shader::checkCompileErrors(job.program, "PROGRAM");
+        // for the parallel path this is submit to completion, not compile time
+        job.info.milliseconds = elapsedMs(job.start);
+        if (linked && job.useCache)
+            ProgramCache::store(job.program, job.cacheKey);
+        glDetachShader(job.program, job.vertex);
+        glDetachShader(job.program, job.fragment);
+        glDeleteShader(job.vertex);
+        glDeleteShader(job.fragment);
+        job.vertex = job.fragment = 0;
+    }
+    static void ready(Job &job)
+    {
+        job.promise.set_value(Shader(job.program, job.info));
+        job.program = 0;
+    }
+    static void discard(Job &job)
+    {
+        if (job.vertex)
+            glDeleteShader(job.vertex);
+        if (job.fragment)
+            glDeleteShader(job.fragment);
+        if (job.program)
+            glDeleteProgram(job.program);
+    }
+    static double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void workerMain(std::function<bool()> makeSharedContextCurrent)
+    {
+        if (!makeSharedContextCurrent())
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            workerFailed = true;
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this] { return stopping || !queued.empty(); });
+            if (stopping)
+                break;
+            std::unique_ptr<Job> job = std::move(queued.front());
+            queued.pop_front();
+            lock.unlock();
+            if (!start(*job))
+                complete(*job);
+            // the GL thread may use the program as soon as it sees it
+            glFinish();
+            lock.lock();
+            compiled.push_back(std::move(job));
+        }
+    }
+};
+#endif
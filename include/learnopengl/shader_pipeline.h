@@ -0,0 +1,121 @@
+#ifndef SHADER_PIPELINE_H
+#define SHADER_PIPELINE_H
+
+#include <glad/glad.h>
+#include <learnopengl/shader_s.h>
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <iostream>
+
+// program pipelines (GL 4.1, or GL_ARB_separate_shader_objects): every stage
+// is compiled once into its own separable program, and a combination of
+// stages is put together when it is bound instead of being linked. n vertex
+// shaders times m materials costs n + m compiles rather than n * m links.
+//
+// stage() returns the separable program for a source, compiling it the
+// first time only; bind() makes the pipeline of those stages current,
+// creating it the first time that tuple of stages is bound. set uniforms on
+// the stage programs themselves: their setters work without use().
+//
+//   Shader &vertex = pipelines.stage(GL_VERTEX_SHADER, vertexCode);
+//   Shader &orange = pipelines.stage(GL_FRAGMENT_SHADER, orangeCode);
+//   pipelines.bind(vertex, orange);
+//   glDrawArrays(...);
+class ShaderPipelines
+{
+public:
+    ShaderPipelines() = default;
+    ~ShaderPipelines()
+    {
+        clear();
+    }
+    ShaderPipelines(const ShaderPipelines &) = delete;
+    ShaderPipelines &operator=(const ShaderPipelines &) = delete;
+    static bool supported()
+    {
+        return GLAD_GL_ARB_separate_shader_objects != 0;
+    }
+
+    // the separable program for this stage's source; stays valid as long as
+    // the cache
+    Shader &stage(GLenum type, std::string_view code)
+    {
+        std::string key = std::to_string(type) + ':';
+        key += code;
+        auto it = stages.find(key);
+        if (it == stages.end())
+        {
+            std::unique_ptr<Shader> shader(new Shader(Shader::separableStage(type, code)));
+            it = stages.emplace(std::move(key), std::move(shader)).first;
+        }
+        return *it->second;
+    }
+    // make the pipeline of these stages current. a program made current with
+    // glUseProgram / Shader::use() would take precedence, so that is cleared
+    unsigned int bind(const Shader &vertex, const Shader &fragment, const Shader *geometry = nullptr,
+                      const Shader *tessControl = nullptr, const Shader *tessEvaluation = nullptr)
+    {
+        unsigned int pipeline = get(vertex, fragment, geometry, tessControl, tessEvaluation);
+        glUseProgram(0);
+        glBindProgramPipeline(pipeline);
+        return pipeline;
+    }
+    // the pipeline of these stages, created on first use
+    unsigned int get(const Shader &vertex, const Shader &fragment, const Shader *geometry = nullptr,
+                     const Shader *tessControl = nullptr, const Shader *tessEvaluation = nullptr)
+    {
+        Key key = {vertex.ID, fragment.ID, geometry ? geometry->ID : 0u, tessControl ? tessControl->ID : 0u,
+                   tessEvaluation ? tessEvaluation->ID : 0u};
+        auto it = pipelines.find(key);
+        if (it != pipelines.end())
+            return it->second;
+
+        unsigned int pipeline;
+        glGenProgramPipelines(1, &pipeline);
+        const GLbitfield bits[] = {GL_VERTEX_SHADER_BIT, GL_FRAGMENT_SHADER_BIT, GL_GEOMETRY_SHADER_BIT,
+                                   GL_TESS_CONTROL_SHADER_BIT, GL_TESS_EVALUATION_SHADER_BIT};
+        for (int i = 0; i < 5; ++i)
+        {
+            if (key[i])
+                glUseProgramStages(pipeline, bits[i], key[i]);
+        }
+        // catches stages whose interfaces don't match
+        glValidateProgramPipeline(pipeline);
+        int valid = 0;
+        glGetProgramPipelineiv(pipeline, GL_VALIDATE_STATUS, &valid);
+        if (!valid)
+        {
+            char infoLog[1024] = "";
+            glGetProgramPipelineInfoLog(pipeline, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_PIPELINE_VALIDATION_ERROR\n"
+                      << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+        pipelines.emplace(key, pipeline);
+        return pipeline;
+    }
+    size_t stageCount() const { return stages.size(); }
+    size_t pipelineCount() const { return pipelines.size(); }
+    // delete every pipeline and stage program; call it while the context is
+    // still alive if the cache outlives it
+    void clear()
+    {
+        for (auto &pipeline : pipelines)
+            glDeleteProgramPipelines(1, &pipeline.second);
+        for (auto &stage : stages)
+            glDeleteProgram(stage.second->ID);
+        pipelines.clear();
+        stages.clear();
+    }
+
+private:
+    // program of each stage: vertex, fragment, geometry, tess control, tess evaluation
+    typedef std::array<unsigned int, 5> Key;
+    std::unordered_map<std::string, std::unique_ptr<Shader>> stages; // type + source -> program
+    std::map<Key, unsigned int> pipelines;
+};
+#endif
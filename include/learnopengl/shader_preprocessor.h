@@ -0,0 +1,275 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <glad/glad.h>
+#include <learnopengl/shader_s.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+#include <iostream>
+
+// expands #include "file" (or <file>) in GLSL sources and injects #define
+// permutation keys after #version. a quoted name is looked for next to the
+// including file first, then in the include paths; a file with #pragma once
+// is included once per shader. #line directives keep compiler messages
+// pointing at the right line: source string 0 is the top file and the
+// includes are numbered in the order they were first seen, as expand()
+// reports them. files are read once and kept, so expanding many
+// permutations of the same shader only touches the disk the first time
+class ShaderPreprocessor
+{
+public:
+    void addIncludePath(const std::string &dir)
+    {
+        includePaths.push_back(dir);
+    }
+    // forget the files read so far, e.g. after they were edited
+    void clearFileCache()
+    {
+        files.clear();
+    }
+    // expand path into out. defines are "NAME" (defined as 1) or "NAME=VALUE";
+    // only the ones the expanded source mentions are injected, so keys that
+    // don't concern this shader don't make it a different text. sourceNames,
+    // if given, receives the file of each #line source string number
+    bool expand(const std::string &path, const std::vector<std::string> &defines, std::string &out,
+                std::vector<std::string> *sourceNames = nullptr)
+    {
+        Expansion e;
+        std::string body;
+        if (!expandFile(normalize(path), body, e))
+            return false;
+
+        std::string header;
+        for (const std::string &define : defines)
+        {
+            size_t eq = define.find('=');
+            std::string name = define.substr(0, eq);
+            if (!mentions(body, name))
+                continue;
+            header += "#define " + name + " " + (eq == std::string::npos ? "1" : define.substr(eq + 1)) + "\n";
+        }
+        // #version must stay the first thing in the shader
+        out.clear();
+        if (!e.version.empty())
+            out = e.version + "\n";
+        out += header;
+        // the #version line left a blank line behind, so the body starts at line 1
+        if (!header.empty() || !e.version.empty())
+            out += "#line 1 0\n";
+        out += body;
+        if (sourceNames)
+            *sourceNames = e.names;
+        return true;
+    }
+
+private:
+    std::vector<std::string> includePaths;
+    std::unordered_map<std::string, std::string> files; // path -> contents
+
+    struct Expansion
+    {
+        std::vector<std::string> names; // index = #line source string number
+        std::vector<std::string> stack; // files being expanded, to catch cycles
+        std::set<std::string> once;     // files that said #pragma once
+        std::string version;            // the top file's #version line
+    };
+
+    static std::string normalize(const std::string &path)
+    {
+        std::error_code ec;
+        std::filesystem::path p = std::filesystem::absolute(path, ec);
+        return (ec ? std::filesystem::path(path) : p).lexically_normal().string();
+    }
+    const std::string *read(const std::string &path)
+    {
+        auto it = files.find(path);
+        if (it == files.end())
+        {
+            std::string code;
+            if (!Shader::readFile(path.c_str(), code))
+                return nullptr;
+            it = files.emplace(path, std::move(code)).first;
+        }
+        return &it->second;
+    }
+    std::string resolve(const std::string &name, const std::string &from, bool quoted)
+    {
+        std::error_code ec;
+        if (quoted)
+        {
+            std::filesystem::path local = std::filesystem::path(from).parent_path() / name;
+            if (std::filesystem::exists(local, ec))
+                return normalize(local.string());
+        }
+        for (const std::string &dir : includePaths)
+        {
+            std::filesystem::path candidate = std::filesystem::path(dir) / name;
+            if (std::filesystem::exists(candidate, ec))
+                return normalize(candidate.string());
+        }
+        return std::string();
+    }
+    // true if name occurs in code as a whole identifier
+    static bool mentions(const std::string &code, const std::string &name)
+    {
+        auto ident = [](char c) { return isalnum((unsigned char)c) || c == '_'; };
+        for (size_t at = code.find(name); at != std::string::npos; at = code.find(name, at + 1))
+        {
+            if ((at == 0 || !ident(code[at - 1])) && (at + name.size() == code.size() || !ident(code[at + name.size()])))
+                return true;
+        }
+        return false;
+    }
+    bool expandFile(const std::string &path, std::string &out, Expansion &e)
+    {
+        if (std::find(e.stack.begin(), e.stack.end(), path) != e.stack.end())
+        {
+            std::cout << "ERROR::SHADER::INCLUDE_CYCLE: " << path << std::endl;
+            return false;
+        }
+        const std::string *code = read(path);
+        if (!code)
+            return false;
+        int index = (int)(std::find(e.names.begin(), e.names.end(), path) - e.names.begin());
+        if (index == (int)e.names.size())
+            e.names.push_back(path);
+        e.stack.push_back(path);
+
+        int line = 0;
+        for (size_t pos = 0; pos < code->size();)
+        {
+            size_t end = code->find('\n', pos);
+            if (end == std::string::npos)
+                end = code->size();
+            std::string text = code->substr(pos, end - pos);
+            pos = end + 1;
+            ++line;
+
+            size_t first = text.find_first_not_of(" \t");
+            std::string directive = first == std::string::npos || text[first] != '#' ? std::string() : text.substr(first + 1);
+            directive.erase(0, directive.find_first_not_of(" \t"));
+            if (directive.compare(0, 7, "version") == 0)
+            {
+                // only the top file's counts; it is put back in front later
+                if (e.stack.size() == 1 && e.version.empty())
+                    e.version = text;
+                out += "\n";
+            }
+            else if (directive.compare(0, 11, "pragma once") == 0)
+            {
+                e.once.insert(path);
+                out += "\n";
+            }
+            else if (directive.compare(0, 7, "include") == 0)
+            {
+                size_t open = directive.find_first_of("\"<", 7);
+                size_t close = open == std::string::npos ? open : directive.find(directive[open] == '"' ? '"' : '>', open + 1);
+                if (close == std::string::npos)
+                {
+                    std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << ":" << line << std::endl;
+                    return false;
+                }
+                std::string name = directive.substr(open + 1, close - open - 1);
+                std::string file = resolve(name, path, directive[open] == '"');
+                if (file.empty())
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << name << " in " << path << ":" << line << std::endl;
+                    return false;
+                }
+                if (!e.once.count(file))
+                {
+                    size_t before = e.names.size();
+                    int included = (int)(std::find(e.names.begin(), e.names.end(), file) - e.names.begin());
+                    out += "#line 1 " + std::to_string(included < (int)before ? included : (int)before) + "\n";
+                    if (!expandFile(file, out, e))
+                        return false;
+                    if (!out.empty() && out.back() != '\n')
+                        out += "\n";
+                }
+                out += "#line " + std::to_string(line + 1) + " " + std::to_string(index) + "\n";
+            }
+            else
+                out += text + "\n";
+        }
+        e.stack.pop_back();
+        return true;
+    }
+};
+
+// one Shader per permutation of a vertex/fragment pair. asking for the same
+// files and defines again returns the same Shader without touching the disk
+// or the driver, and permutations whose expanded sources come out identical
+// (e.g. they only differ in keys the shader never mentions) share one program.
+// a permutation that fails to expand or link isn't kept, so asking again
+// (e.g. after fixing the file and clearFileCache()) tries again
+class ShaderPermutations
+{
+public:
+    explicit ShaderPermutations(ShaderPreprocessor &preprocessor)
+        : preprocessor(preprocessor)
+    {
+    }
+    // the Shader stays valid as long as this cache; nullptr if an include is
+    // missing or cyclic, or the program doesn't link
+    Shader *get(const std::string &vertexPath, const std::string &fragmentPath, std::vector<std::string> defines = {})
+    {
+        std::sort(defines.begin(), defines.end());
+        defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+        std::string key = vertexPath + '\n' + fragmentPath;
+        for (const std::string &define : defines)
+            key += '\n' + define;
+        ++requests;
+        auto variant = variants.find(key);
+        if (variant != variants.end())
+            return variant->second;
+
+        std::string vertexCode, fragmentCode;
+        std::vector<std::string> vertexNames, fragmentNames;
+        if (!preprocessor.expand(vertexPath, defines, vertexCode, &vertexNames) ||
+            !preprocessor.expand(fragmentPath, defines, fragmentCode, &fragmentNames))
+            return nullptr;
+        std::string sources = vertexCode + '\0' + fragmentCode;
+        auto program = programs.find(sources);
+        if (program == programs.end())
+        {
+            std::unique_ptr<Shader> shader(new Shader(Shader::fromSource(vertexCode, fragmentCode)));
+            int linked = 0;
+            glGetProgramiv(shader->ID, GL_LINK_STATUS, &linked);
+            if (!linked)
+            {
+                printSourceNames(vertexNames, fragmentNames);
+                glDeleteProgram(shader->ID);
+                return nullptr;
+            }
+            program = programs.emplace(std::move(sources), std::move(shader)).first;
+        }
+        variants.emplace(std::move(key), program->second.get());
+        return program->second.get();
+    }
+    size_t requestCount() const { return requests; }          // calls to get()
+    size_t variantCount() const { return variants.size(); }   // distinct files + defines asked for
+    size_t programCount() const { return programs.size(); }   // distinct programs built
+
+private:
+    ShaderPreprocessor &preprocessor;
+    std::unordered_map<std::string, Shader *> variants;                  // files + sorted defines -> program
+    std::unordered_map<std::string, std::unique_ptr<Shader>> programs; // expanded sources -> program
+    size_t requests = 0;
+
+    static void printSourceNames(const std::vector<std::string> &vertexNames, const std::vector<std::string> &fragmentNames)
+    {
+        std::cout << "source strings of the vertex shader:" << std::endl;
+        for (size_t i = 0; i < vertexNames.size(); ++i)
+            std::cout << "  " << i << ": " << vertexNames[i] << std::endl;
+        std::cout << "source strings of the fragment shader:" << std::endl;
+        for (size_t i = 0; i < fragmentNames.size(); ++i)
+            std::cout << "  " << i << ": " << fragmentNames[i] << std::endl;
+    }
+};
+#endif
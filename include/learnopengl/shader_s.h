@@ -2,109 +2,145 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <learnopengl/program_cache.h>
 
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <chrono>
+
+// an active uniform of a Shader, looked up once with Shader::uniform() and
+// then passed to the setters instead of the name. a handle for a name the
+// program doesn't use is invalid and its setters do nothing, just like
+// location -1
+struct UniformHandle
+{
+    int index = -1;
+    bool valid() const { return index >= 0; }
+};
+
+// how a Shader's program came to be
+struct ProgramBuildInfo
+{
+    bool cacheHit = false;     // loaded from the ProgramCache instead of compiled
+    double milliseconds = 0.0; // compile + link, or cache load
+};
+
+// the GLSL of each stage of a program; the empty ones are left out. a
+// compute program has nothing but compute (see ComputeShader)
+struct ShaderStages
+{
+    std::string_view vertex, tessControl, tessEvaluation, geometry, fragment, compute;
+};
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    ProgramBuildInfo buildInfo;
+    // constructor generates the shader on the fly. the geometry and
+    // tessellation stages are optional (tessellation needs GL 4.0)
     // ------------------------------------------------------------------------
-    Shader(const char *vertexPath, const char *fragmentPath)
+    Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr,
+           const char *tessControlPath = nullptr, const char *tessEvaluationPath = nullptr)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // std::cout << vertexPath << std::endl;
-            // std::cout << fragmentPath << std::endl;
-
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-
-            // std::cout << vertexCode << std::endl;
-            // std::cout << fragmentCode << std::endl;
-        }
-        catch (std::ifstream::failure &e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-
-        // std::cout << "---> " << fShaderCode << std::endl;
-
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        std::string geometryCode, tessControlCode, tessEvaluationCode;
+        readFile(vertexPath, vertexCode);
+        readFile(fragmentPath, fragmentCode);
+        if (geometryPath)
+            readFile(geometryPath, geometryCode);
+        if (tessControlPath)
+            readFile(tessControlPath, tessControlCode);
+        if (tessEvaluationPath)
+            readFile(tessEvaluationPath, tessEvaluationCode);
+        ShaderStages stages;
+        stages.vertex = vertexCode;
+        stages.tessControl = tessControlCode;
+        stages.tessEvaluation = tessEvaluationCode;
+        stages.geometry = geometryCode;
+        stages.fragment = fragmentCode;
+        build(stages);
     }
-    // activate the shader
+    // build from sources already in memory, e.g. string literals or a
+    // ShaderArchive; nothing is read from disk and the sources aren't copied
     // ------------------------------------------------------------------------
-    void use()
+    static Shader fromSource(std::string_view vertexCode, std::string_view fragmentCode)
     {
-        glUseProgram(ID);
+        ShaderStages stages;
+        stages.vertex = vertexCode;
+        stages.fragment = fragmentCode;
+        return fromSource(stages);
     }
-    // utility uniform functions
+    static Shader fromSource(const ShaderStages &stages)
+    {
+        Shader shader;
+        shader.build(stages);
+        return shader;
+    }
+    // a program of just one stage (e.g. GL_VERTEX_SHADER), linked as
+    // separable so that a ShaderPipelines can combine it with other stages
+    // without relinking. its setters use glProgramUniform* and so don't need
+    // use(), which a pipeline's programs never get
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    static Shader separableStage(GLenum type, std::string_view code)
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        ShaderStages stages;
+        std::string_view *stage = type == GL_VERTEX_SHADER ? &stages.vertex
+                                  : type == GL_TESS_CONTROL_SHADER ? &stages.tessControl
+                                  : type == GL_TESS_EVALUATION_SHADER ? &stages.tessEvaluation
+                                  : type == GL_GEOMETRY_SHADER ? &stages.geometry
+                                  : type == GL_FRAGMENT_SHADER ? &stages.fragment
+                                                                : &stages.compute;
+        *stage = code;
+        Shader shader;
+        shader.separableProgram = true;
+        shader.build(stages);
+        return shader;
     }
+    bool separable() const { return separableProgram; }
+    // adopt a program that is already linked, e.g. by a ShaderCompiler
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    Shader(unsigned int program, const ProgramBuildInfo &info)
+        : ID(program), buildInfo(info)
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        loadUniforms();
     }
+    // move-only: two Shaders with the same ID would each remember values the
+    // other one may have overwritten since
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    Shader(Shader &&) = default;
+    Shader &operator=(Shader &&) = default;
+    // read a whole shader file into code; reports and returns false on failure
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    static bool readFile(const char *path, std::string &code)
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        // one fread straight into the string
+        FILE *file = fopen(path, "rb");
+        long size = -1;
+        if (file && fseek(file, 0, SEEK_END) == 0)
+            size = ftell(file);
+        bool ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+        if (ok)
+        {
+            code.resize((size_t)size);
+            ok = fread(&code[0], 1, code.size(), file) == code.size();
+        }
+        if (file)
+            fclose(file);
+        if (!ok)
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return ok;
     }
-
-private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type)
+    static bool checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
         char infoLog[1024];
@@ -128,6 +164,447 @@ private:
                           << infoLog << "\n -- ------------------------zz--------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
+    }
+    // activate the shader
+    // ------------------------------------------------------------------------
+    void use()
+    {
+        glUseProgram(ID);
+    }
+    // look up an active uniform; a handle stays valid for the program's lifetime
+    // ------------------------------------------------------------------------
+    UniformHandle uniform(const char *name) const
+    {
+        UniformHandle h;
+        if (uniformSlots.empty())
+            return h;
+        size_t mask = uniformSlots.size() - 1;
+        for (size_t i = hashName(name) & mask; uniformSlots[i] >= 0; i = (i + 1) & mask)
+        {
+            if (uniformNames[uniformSlots[i]].name == name)
+            {
+                h.index = uniformNames[uniformSlots[i]].index;
+                break;
+            }
+        }
+        return h;
+    }
+    UniformHandle uniform(const std::string &name) const
+    {
+        return uniform(name.c_str());
+    }
+    // the setters remember the last value they uploaded and skip the GL call
+    // when it hasn't changed. call this after changing uniforms of ID with
+    // glUniform* directly, so that the next set uploads again
+    // ------------------------------------------------------------------------
+    void invalidateUniformCache()
+    {
+        for (Uniform &u : uniforms)
+            u.known = false;
+    }
+    // replace the program with a newly linked one, e.g. a hot-reloaded
+    // version. handles stay valid, and the values set on the old program are
+    // set again on the new one; uniforms it no longer has are ignored until a
+    // later program brings them back
+    // ------------------------------------------------------------------------
+    void adopt(unsigned int program)
+    {
+        int current = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+        unsigned int old = ID;
+        ID = program;
+        loadUniforms();
+        glUseProgram(ID);
+        for (const Uniform &u : uniforms)
+        {
+            if (u.known && u.location >= 0)
+                upload(u);
+        }
+        // whoever used the old program now uses the new one
+        glUseProgram((unsigned int)current == old ? ID : (unsigned int)current);
+        glDeleteProgram(old);
+    }
+    // bind an active uniform block to a binding point, where a buffer is
+    // attached with glBindBufferBase/Range (see UniformRing). returns false if
+    // the program has no such block. the binding survives adopt()
+    // ------------------------------------------------------------------------
+    bool bindUniformBlock(const char *name, unsigned int binding)
+    {
+        for (UniformBlock &b : uniformBlocks)
+        {
+            if (b.name == name)
+            {
+                b.binding = (int)binding;
+                if (b.index != GL_INVALID_INDEX)
+                    glUniformBlockBinding(ID, b.index, binding);
+                return b.index != GL_INVALID_INDEX;
+            }
+        }
+        return false;
+    }
+    // bytes the buffer range bound to the block must hold, 0 if not active
+    // ------------------------------------------------------------------------
+    int uniformBlockSize(const char *name) const
+    {
+        for (const UniformBlock &b : uniformBlocks)
+        {
+            if (b.name == name && b.index != GL_INVALID_INDEX)
+                return b.size;
+        }
+        return 0;
+    }
+    // utility uniform functions
+    // ------------------------------------------------------------------------
+    void setBool(UniformHandle h, bool value) const
+    {
+        setInt(h, (int)value);
+    }
+    void setBool(const std::string &name, bool value) const
+    {
+        setInt(uniform(name), (int)value);
+    }
+    // ------------------------------------------------------------------------
+    void setInt(UniformHandle h, int value) const
+    {
+        set<Int>(h, &value);
+    }
+    void setInt(const std::string &name, int value) const
+    {
+        setInt(uniform(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setFloat(UniformHandle h, float value) const
+    {
+        set<Float>(h, &value);
+    }
+    void setFloat(const std::string &name, float value) const
+    {
+        setFloat(uniform(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setVec2(UniformHandle h, const float *value) const
+    {
+        set<Vec2>(h, value);
+    }
+    void setVec2(const std::string &name, const float *value) const
+    {
+        setVec2(uniform(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setVec3(UniformHandle h, const float *value) const
+    {
+        set<Vec3>(h, value);
+    }
+    void setVec3(const std::string &name, const float *value) const
+    {
+        setVec3(uniform(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setVec4(UniformHandle h, const float *value) const
+    {
+        set<Vec4>(h, value);
+    }
+    void setVec4(const std::string &name, const float *value) const
+    {
+        setVec4(uniform(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setMat4(UniformHandle h, const float *value) const
+    {
+        set<Mat4>(h, value);
+    }
+    void setMat4(const std::string &name, const float *value) const
+    {
+        setMat4(uniform(name), value);
+    }
+
+protected:
+    Shader() : ID(0) {}
+    // compile and link, or load from the ProgramCache
+    // ------------------------------------------------------------------------
+    void build(const ShaderStages &stages)
+    {
+        const std::string_view sources[] = {stages.vertex, stages.tessControl, stages.tessEvaluation,
+                                            stages.geometry, stages.fragment, stages.compute};
+        const GLenum types[] = {GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER,
+                                GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER};
+        const char *names[] = {"VERTEX", "TESS_CONTROL", "TESS_EVALUATION", "GEOMETRY", "FRAGMENT", "COMPUTE"};
+        auto start = std::chrono::steady_clock::now();
+        ID = glCreateProgram();
+        if (separableProgram)
+            glProgramParameteri(ID, GL_PROGRAM_SEPARABLE, GL_TRUE);
+        // a program linked from the same sources on this driver before comes
+        // straight out of the cache
+        bool useCache = ProgramCache::enabled();
+        uint64_t cacheKey = 0;
+        if (useCache)
+        {
+            // the plain vertex + fragment key is the one ShaderCompiler uses too
+            bool plain = !separableProgram && stages.tessControl.empty() && stages.tessEvaluation.empty() &&
+                         stages.geometry.empty() && stages.compute.empty();
+            cacheKey = plain ? ProgramCache::key({stages.vertex, stages.fragment})
+                             : ProgramCache::key({separableProgram ? "separable" : "", sources[0], sources[1],
+                                                  sources[2], sources[3], sources[4], sources[5]});
+            buildInfo.cacheHit = ProgramCache::load(ID, cacheKey);
+        }
+        if (!buildInfo.cacheHit)
+        {
+            // 2. compile shaders, the stages that have a source
+            unsigned int shaders[6] = {};
+            for (int i = 0; i < 6; ++i)
+            {
+                if (sources[i].empty())
+                    continue;
+                const char *code = sources[i].data();
+                GLint length = (GLint)sources[i].size();
+                shaders[i] = glCreateShader(types[i]);
+                glShaderSource(shaders[i], 1, &code, &length);
+                glCompileShader(shaders[i]);
+                checkCompileErrors(shaders[i], names[i]);
+                glAttachShader(ID, shaders[i]);
+            }
+            // shader Program
+            if (useCache)
+                glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(ID);
+            bool linked = checkCompileErrors(ID, "PROGRAM");
+            buildInfo.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (linked && useCache)
+                ProgramCache::store(ID, cacheKey);
+            // delete the shaders as they're linked into our program now and no longer necessary
+            for (unsigned int shader : shaders)
+            {
+                if (!shader)
+                    continue;
+                glDetachShader(ID, shader);
+                glDeleteShader(shader);
+            }
+        }
+        else
+            buildInfo.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        loadUniforms();
+    }
+
+private:
+    enum Kind
+    {
+        Int,
+        Float,
+        Vec2,
+        Vec3,
+        Vec4,
+        Mat4
+    };
+    struct Uniform
+    {
+        int location;
+        bool known;      // value is what the program holds
+        Kind kind;       // the setter that wrote value
+        float value[16]; // last uploaded value, up to a mat4
+    };
+    // a name a uniform is set by; "a" and "a[0]" share one entry
+    struct UniformName
+    {
+        std::string name;
+        int index; // into uniforms
+    };
+    // active uniforms, their names, and an open-addressed hash table of
+    // indices into the names (power-of-two size, -1 marks an empty slot)
+    mutable std::vector<Uniform> uniforms;
+    std::vector<UniformName> uniformNames;
+    std::vector<int> uniformSlots;
+    struct UniformBlock
+    {
+        std::string name;
+        unsigned int index; // GL_INVALID_INDEX if the current program lacks it
+        int size;
+        int binding; // -1 until bindUniformBlock
+    };
+    std::vector<UniformBlock> uniformBlocks;
+    bool separableProgram = false;
+
+    static size_t hashName(const char *name)
+    {
+        // FNV-1a
+        size_t h = 2166136261u;
+        for (; *name; ++name)
+            h = (h ^ (unsigned char)*name) * 16777619u;
+        return h;
+    }
+    static constexpr size_t kindSize(Kind kind)
+    {
+        return kind == Int ? sizeof(int) : kind == Float ? sizeof(float) : kind == Vec2 ? 2 * sizeof(float) : kind == Vec3 ? 3 * sizeof(float) : kind == Vec4 ? 4 * sizeof(float) : 16 * sizeof(float);
+    }
+    // upload value unless it is what h last uploaded
+    template <Kind kind>
+    void set(UniformHandle h, const void *value) const
+    {
+        if (!h.valid())
+            return;
+        Uniform &u = uniforms[h.index];
+        if (u.known && u.kind == kind && memcmp(u.value, value, kindSize(kind)) == 0)
+            return;
+        memcpy(u.value, value, kindSize(kind));
+        u.known = true;
+        u.kind = kind;
+        upload(u);
+    }
+    void upload(const Uniform &u) const
+    {
+        int i;
+        if (separableProgram)
+        {
+            // not current: a pipeline runs it
+            switch (u.kind)
+            {
+            case Int:
+                memcpy(&i, u.value, sizeof(i));
+                glProgramUniform1i(ID, u.location, i);
+                break;
+            case Float:
+                glProgramUniform1f(ID, u.location, u.value[0]);
+                break;
+            case Vec2:
+                glProgramUniform2fv(ID, u.location, 1, u.value);
+                break;
+            case Vec3:
+                glProgramUniform3fv(ID, u.location, 1, u.value);
+                break;
+            case Vec4:
+                glProgramUniform4fv(ID, u.location, 1, u.value);
+                break;
+            case Mat4:
+                glProgramUniformMatrix4fv(ID, u.location, 1, GL_FALSE, u.value);
+                break;
+            }
+            return;
+        }
+        switch (u.kind)
+        {
+        case Int:
+            memcpy(&i, u.value, sizeof(i));
+            glUniform1i(u.location, i);
+            break;
+        case Float:
+            glUniform1f(u.location, u.value[0]);
+            break;
+        case Vec2:
+            glUniform2fv(u.location, 1, u.value);
+            break;
+        case Vec3:
+            glUniform3fv(u.location, 1, u.value);
+            break;
+        case Vec4:
+            glUniform4fv(u.location, 1, u.value);
+            break;
+        case Mat4:
+            glUniformMatrix4fv(u.location, 1, GL_FALSE, u.value);
+            break;
+        }
+    }
+    // the entry for name at location, returning its index. after a relink,
+    // names the old program had keep their entry
+    int addUniform(const std::string &name, int location)
+    {
+        UniformHandle h = uniform(name);
+        if (h.valid())
+        {
+            uniforms[h.index].location = location;
+            return h.index;
+        }
+        Uniform u;
+        u.location = location;
+        u.known = false;
+        uniforms.push_back(u);
+        uniformNames.push_back(UniformName{name, (int)uniforms.size() - 1});
+        return (int)uniforms.size() - 1;
+    }
+    // make name another way to set the entry at index
+    void aliasUniform(const std::string &name, int index)
+    {
+        for (UniformName &n : uniformNames)
+        {
+            if (n.name == name)
+            {
+                n.index = index;
+                return;
+            }
+        }
+        uniformNames.push_back(UniformName{name, index});
+    }
+    // introspect the active uniforms once after linking. array elements get
+    // an entry each: "a[i]", with "a" and "a[0]" naming the same first one.
+    // then the uniform blocks
+    // ------------------------------------------------------------------------
+    void loadUniforms()
+    {
+        for (Uniform &u : uniforms)
+            u.location = -1;
+        int count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> buffer(maxLength + 1);
+        for (int i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            int location = glGetUniformLocation(ID, name.c_str());
+            if (location < 0) // uniform block member
+                continue;
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                aliasUniform(name, addUniform(base, location));
+                for (int e = 1; e < size; ++e)
+                {
+                    std::string element = base + "[" + std::to_string(e) + "]";
+                    addUniform(element, glGetUniformLocation(ID, element.c_str()));
+                }
+            }
+            else
+                addUniform(name, location);
+        }
+
+        size_t slots = 8;
+        while (slots < uniformNames.size() * 2)
+            slots *= 2;
+        uniformSlots.assign(slots, -1);
+        for (size_t i = 0; i < uniformNames.size(); ++i)
+        {
+            size_t j = hashName(uniformNames[i].name.c_str()) & (slots - 1);
+            while (uniformSlots[j] >= 0)
+                j = (j + 1) & (slots - 1);
+            uniformSlots[j] = (int)i;
+        }
+
+        // uniform blocks, keeping the bindings of those a previous program had
+        for (UniformBlock &b : uniformBlocks)
+            b.index = GL_INVALID_INDEX;
+        int blocks = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &blocks);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        buffer.resize(maxLength + 1);
+        for (int i = 0; i < blocks; ++i)
+        {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(ID, i, (GLsizei)buffer.size(), &length, buffer.data());
+            std::string name(buffer.data(), length);
+            int size = 0;
+            glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+            auto b = uniformBlocks.begin();
+            while (b != uniformBlocks.end() && b->name != name)
+                ++b;
+            if (b == uniformBlocks.end())
+                b = uniformBlocks.insert(b, UniformBlock{name, GL_INVALID_INDEX, 0, -1});
+            b->index = (unsigned int)i;
+            b->size = size;
+            if (b->binding >= 0)
+                glUniformBlockBinding(ID, b->index, (unsigned int)b->binding);
+        }
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,452 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <glad/glad.h>
+#include <learnopengl/shader_s.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+// hot reload for Shaders built from files. a thread sleeps on inotify and
+// only flags the files that were written; update(), called once per frame on
+// the GL thread, costs an atomic load until that happens. then the changed
+// stage alone is recompiled and relinked against the other stage's compiled
+// shader, and the Shader adopts the new program at the next update() after it
+// finished, so frames never see a half-built program. if the new source
+// doesn't compile or link, the errors are printed and the old program stays.
+// a shader has one reload in flight at a time: files saved meanwhile are
+// picked up together by the next one, once it finished.
+//
+// like ShaderCompiler, compiles run on the driver's threads when it has
+// GL_KHR_parallel_shader_compile, else on a worker thread if the constructor
+// gets a function that makes a shared context current, else in update().
+// inotify is linux only; elsewhere watch() does nothing
+class ShaderWatcher
+{
+public:
+    explicit ShaderWatcher(std::function<bool()> makeSharedContextCurrent = nullptr)
+    {
+#ifdef __linux__
+        notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notify < 0 || pipe(stopPipe) != 0)
+        {
+            std::cout << "ERROR::SHADER_WATCHER::INOTIFY_UNAVAILABLE" << std::endl;
+            return;
+        }
+        watcher = std::thread(&ShaderWatcher::watchMain, this);
+        if (GLAD_GL_KHR_parallel_shader_compile)
+            mode = Mode::Parallel;
+        else if (makeSharedContextCurrent)
+        {
+            mode = Mode::Worker;
+            worker = std::thread(&ShaderWatcher::workerMain, this, makeSharedContextCurrent);
+        }
+#endif
+    }
+    ~ShaderWatcher()
+    {
+#ifdef __linux__
+        if (watcher.joinable())
+        {
+            char stop = 0;
+            if (write(stopPipe[1], &stop, 1) == 1)
+                watcher.join();
+            else
+                watcher.detach();
+            close(stopPipe[0]);
+            close(stopPipe[1]);
+        }
+        if (notify >= 0)
+            close(notify);
+#endif
+        if (worker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+        clear();
+    }
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    // stop watching every shader and delete the GL objects kept for them.
+    // call it while the context is still current if the watcher outlives it
+    void clear()
+    {
+        std::set<Reload *> unstarted;
+        if (mode == Mode::Worker)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            unstarted.insert(queued.begin(), queued.end());
+            queued.clear();
+        }
+        for (auto &reload : reloads)
+        {
+            // let the worker finish the one it is compiling
+            if (mode == Mode::Worker && !unstarted.count(reload.get()))
+            {
+                while (!reload->compiled.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+            }
+            discard(*reload);
+        }
+        reloads.clear();
+        for (auto &entry : entries)
+        {
+            for (unsigned int stage : entry->stages)
+            {
+                if (stage)
+                    glDeleteShader(stage);
+            }
+        }
+        entries.clear();
+    }
+
+    // reload shader whenever one of its files changes. the shader must stay
+    // alive, and in the same place, as long as the watcher
+    void watch(Shader &shader, const char *vertexPath, const char *fragmentPath)
+    {
+        std::string vertexCode, fragmentCode;
+        Shader::readFile(vertexPath, vertexCode);
+        Shader::readFile(fragmentPath, fragmentCode);
+        watch(shader, vertexPath, fragmentPath, vertexCode, fragmentCode);
+    }
+    // the same, for a shader built from sources the caller already has (e.g.
+    // out of a ShaderArchive) that match the files, so they aren't read again
+    void watch(Shader &shader, const char *vertexPath, const char *fragmentPath,
+               std::string_view vertexCode, std::string_view fragmentCode)
+    {
+        std::unique_ptr<Entry> entry(new Entry);
+        entry->shader = &shader;
+        entry->paths[0] = normalize(vertexPath);
+        entry->paths[1] = normalize(fragmentPath);
+        entry->code[0] = entry->latest[0] = vertexCode;
+        entry->code[1] = entry->latest[1] = fragmentCode;
+        for (int k = 0; k < 2; ++k)
+        {
+#ifdef __linux__
+            std::string dir = std::filesystem::path(entry->paths[k]).parent_path().string();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (notify >= 0 && !directories.count(dir))
+            {
+                // watch the directory, not the file: editors that save by
+                // renaming a new file over the old one replace its inode
+                int wd = inotify_add_watch(notify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (wd >= 0)
+                {
+                    directories.insert(dir);
+                    watches[wd] = dir;
+                }
+            }
+#endif
+        }
+        entries.push_back(std::move(entry));
+    }
+    // start reloads for changed files and swap in finished ones; call at the
+    // start or end of a frame. returns true if a shader got a new program
+    bool update()
+    {
+        if (!changed.load(std::memory_order_acquire) && reloads.empty())
+            return false;
+        if (changed.exchange(false, std::memory_order_acquire))
+        {
+            readChanges();
+            startReloads();
+        }
+        bool swapped = false, finished = false;
+        for (auto it = reloads.begin(); it != reloads.end();)
+        {
+            Reload &reload = **it;
+            if (mode == Mode::Parallel)
+            {
+                int done = 0;
+                glGetProgramiv(reload.program, GL_COMPLETION_STATUS_KHR, &done);
+                if (!done)
+                {
+                    ++it;
+                    continue;
+                }
+            }
+            else if (mode == Mode::Worker)
+            {
+                if (!reload.compiled.load(std::memory_order_acquire))
+                {
+                    ++it;
+                    continue;
+                }
+                if (!reload.program) // the worker has no context
+                    compile(reload);
+            }
+            swapped |= finish(reload);
+            finished = true;
+            it = reloads.erase(it);
+        }
+        // files saved while their shader was reloading
+        if (finished)
+            startReloads();
+        return swapped;
+    }
+
+private:
+    enum class Mode
+    {
+        Synchronous,
+        Parallel,
+        Worker
+    };
+    struct Entry
+    {
+        Shader *shader;
+        std::string paths[2];           // vertex, fragment
+        std::string code[2];            // sources of the current program
+        std::string latest[2];          // newest sources read from the files
+        unsigned int stages[2] = {0, 0}; // compiled shaders of the current program, once a reload made them
+        bool dirty = false;             // latest changed since the last reload started
+        bool reloading = false;         // a Reload is in flight; the next one waits for it
+    };
+    struct Reload
+    {
+        Entry *entry;
+        std::string code[2];
+        bool recompile[2] = {false, false};
+        unsigned int stages[2] = {0, 0}; // the program's shaders: new ones where recompiled, else the entry's
+        unsigned int program = 0;
+        std::atomic<bool> compiled{false};
+    };
+
+    Mode mode = Mode::Synchronous;
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::deque<std::unique_ptr<Reload>> reloads;
+    std::atomic<bool> changed{false};
+    std::mutex mutex;
+    std::set<std::string> changedFiles; // guarded by mutex
+
+    // inotify thread
+    std::thread watcher;
+    int notify = -1;
+    int stopPipe[2] = {-1, -1};
+    std::set<std::string> directories; // guarded by mutex
+    std::map<int, std::string> watches; // guarded by mutex
+
+    // worker mode
+    std::thread worker;
+    std::condition_variable wake;
+    std::deque<Reload *> queued; // guarded by mutex
+    bool stopping = false;
+
+    static std::string normalize(const char *path)
+    {
+        std::error_code ec;
+        std::filesystem::path p = std::filesystem::absolute(path, ec);
+        return (ec ? std::filesystem::path(path) : p).lexically_normal().string();
+    }
+
+    // read the files inotify reported into the entries that use them
+    void readChanges()
+    {
+        std::set<std::string> files;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            files.swap(changedFiles);
+        }
+        for (auto &entry : entries)
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                std::string code;
+                if (!files.count(entry->paths[k]) || !Shader::readFile(entry->paths[k].c_str(), code) || code == entry->latest[k])
+                    continue;
+                entry->latest[k] = code;
+                entry->dirty = true;
+            }
+        }
+    }
+    // start a reload of the newest sources for every changed entry that
+    // isn't reloading already
+    void startReloads()
+    {
+        for (auto &entry : entries)
+        {
+            if (!entry->dirty || entry->reloading)
+                continue;
+            entry->dirty = false;
+            std::unique_ptr<Reload> reload(new Reload);
+            reload->entry = entry.get();
+            bool changedStage = false;
+            for (int k = 0; k < 2; ++k)
+            {
+                reload->code[k] = entry->latest[k];
+                reload->recompile[k] = entry->latest[k] != entry->code[k];
+                changedStage |= reload->recompile[k];
+            }
+            if (!changedStage) // saved back to what the program was built from
+                continue;
+            // the first reload also compiles the stage that didn't change:
+            // the Shader constructor deleted its shaders after linking
+            for (int k = 0; k < 2; ++k)
+            {
+                if (!entry->stages[k])
+                    reload->recompile[k] = true;
+                else if (!reload->recompile[k])
+                    reload->stages[k] = entry->stages[k];
+                if (reload->recompile[k])
+                    std::cout << "SHADER::RELOADING: " << entry->paths[k] << std::endl;
+            }
+            entry->reloading = true;
+            if (mode == Mode::Worker)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    queued.push_back(reload.get());
+                }
+                wake.notify_one();
+            }
+            else
+                compile(*reload);
+            reloads.push_back(std::move(reload));
+        }
+    }
+    // compile the marked stages and link; doesn't wait for the results
+    static void compile(Reload &reload)
+    {
+        static const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+        reload.program = glCreateProgram();
+        for (int k = 0; k < 2; ++k)
+        {
+            if (reload.recompile[k])
+            {
+                const char *code = reload.code[k].c_str();
+                reload.stages[k] = glCreateShader(types[k]);
+                glShaderSource(reload.stages[k], 1, &code, NULL);
+                glCompileShader(reload.stages[k]);
+            }
+            glAttachShader(reload.program, reload.stages[k]);
+        }
+        glLinkProgram(reload.program);
+    }
+    // swap the reloaded program in if it built
+    static bool finish(Reload &reload)
+    {
+        static const char *types[2] = {"VERTEX", "FRAGMENT"};
+        Entry &entry = *reload.entry;
+        entry.reloading = false;
+        bool ok = true;
+        for (int k = 0; k < 2; ++k)
+        {
+            if (reload.recompile[k] && !Shader::checkCompileErrors(reload.stages[k], types[k]))
+                ok = false;
+        }
+        if (ok && !Shader::checkCompileErrors(reload.program, "PROGRAM"))
+            ok = false;
+        if (!ok)
+        {
+            std::cout << "SHADER::RELOAD_FAILED: keeping the previous program" << std::endl;
+            discard(reload);
+            return false;
+        }
+        for (int k = 0; k < 2; ++k)
+        {
+            glDetachShader(reload.program, reload.stages[k]);
+            if (reload.recompile[k])
+            {
+                if (entry.stages[k])
+                    glDeleteShader(entry.stages[k]);
+                entry.stages[k] = reload.stages[k];
+                entry.code[k] = reload.code[k];
+            }
+        }
+        entry.shader->adopt(reload.program);
+        return true;
+    }
+    static void discard(Reload &reload)
+    {
+        for (int k = 0; k < 2; ++k)
+        {
+            if (reload.recompile[k] && reload.stages[k])
+                glDeleteShader(reload.stages[k]);
+        }
+        if (reload.program)
+            glDeleteProgram(reload.program);
+    }
+
+#ifdef __linux__
+    void watchMain()
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        pollfd fds[2] = {{notify, POLLIN, 0}, {stopPipe[0], POLLIN, 0}};
+        for (;;)
+        {
+            if (poll(fds, 2, -1) < 0)
+                continue;
+            if (fds[1].revents)
+                return;
+            ssize_t length;
+            bool any = false;
+            while ((length = read(notify, buffer, sizeof(buffer))) > 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (char *p = buffer; p < buffer + length;)
+                {
+                    const struct inotify_event *event = (const struct inotify_event *)p;
+                    auto dir = watches.find(event->wd);
+                    if (event->len && dir != watches.end())
+                    {
+                        changedFiles.insert((std::filesystem::path(dir->second) / event->name).lexically_normal().string());
+                        any = true;
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            if (any)
+                changed.store(true, std::memory_order_release);
+        }
+    }
+#endif
+
+    void workerMain(std::function<bool()> makeSharedContextCurrent)
+    {
+        bool haveContext = makeSharedContextCurrent();
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this] { return stopping || !queued.empty(); });
+            if (stopping)
+                break;
+            Reload *reload = queued.front();
+            queued.pop_front();
+            lock.unlock();
+            if (haveContext)
+            {
+                compile(*reload);
+                // the GL thread may use the program as soon as it sees it
+                glFinish();
+            }
+            reload->compiled.store(true, std::memory_order_release);
+            lock.lock();
+        }
+    }
+};
+#endif
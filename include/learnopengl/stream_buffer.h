@@ -0,0 +1,195 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+
+// part of a StreamBuffer written this frame; offset is what goes to
+// glVertexAttribPointer, glDrawElements or glBindBufferRange
+struct StreamRange
+{
+    unsigned int buffer = 0;
+    size_t offset = 0, size = 0;
+    unsigned char *data = nullptr;
+
+    bool valid() const { return data != nullptr; }
+};
+
+// a buffer for data that changes every frame (vertices, indices, uniforms),
+// written in place instead of with glBufferData / glBufferSubData, which
+// either stall until the GPU is done with the old contents or orphan them.
+//
+// the buffer is split into `frames` regions used in turn, so the CPU writes
+// one while the GPU may still read the others; a fence per region makes
+// beginFrame() wait in the rare case the GPU is that far behind. with
+// GL_ARB_buffer_storage the buffer is mapped once, persistently and
+// coherently. without it (GL 3.3, macOS) the region is mapped with
+// GL_MAP_UNSYNCHRONIZED_BIT, which the fences make safe, and unmapped by
+// flush().
+//
+// buffers aren't tied to a target, so the mapping goes through
+// GL_COPY_WRITE_BUFFER and leaves the VAO's element buffer alone; bind id()
+// wherever the data is used.
+//
+//   ring.beginFrame();
+//   StreamRange vertices = ring.write(data, bytes);
+//   ring.flush();   // before the draws
+//   glBindBuffer(GL_ARRAY_BUFFER, ring.id());
+//   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *)vertices.offset);
+class StreamBuffer
+{
+public:
+    // regions start on this many bytes, enough for any offset alignment GL asks for
+    static const size_t regionAlignment = 256;
+
+    explicit StreamBuffer(size_t bytesPerFrame, int frames = 3)
+        : frames(frames), fences(frames, nullptr)
+    {
+        regionSize = (bytesPerFrame + regionAlignment - 1) / regionAlignment * regionAlignment;
+        size_t total = regionSize * frames;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (GLAD_GL_ARB_buffer_storage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)total, nullptr, flags);
+            persistentMapping = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)total, flags);
+            if (!persistentMapping)
+            {
+                // storage is immutable: start over with a plain buffer
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            }
+        }
+        if (!persistentMapping)
+            glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)total, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        cursor = flushed = 0;
+        regionEnd = regionSize;
+    }
+    ~StreamBuffer()
+    {
+        for (GLsync fence : fences)
+        {
+            if (fence)
+                glDeleteSync(fence);
+        }
+        if (persistentMapping || mapping)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    // move on to the next region, once the GPU is done reading it
+    void beginFrame()
+    {
+        flush();
+        if (started)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        started = true;
+        region = (region + 1) % frames;
+        if (fences[region])
+        {
+            GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                ++waits;
+                while (status == GL_TIMEOUT_EXPIRED)
+                    status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            glDeleteSync(fences[region]);
+            fences[region] = nullptr;
+        }
+        flushed = cursor = region * regionSize;
+        regionEnd = cursor + regionSize;
+    }
+    // room for size bytes of this frame, starting on a multiple of alignment
+    // (a power of two); invalid if the frame is full
+    StreamRange allocate(size_t size, size_t alignment = 4)
+    {
+        StreamRange range;
+        size_t offset = (cursor + alignment - 1) & ~(alignment - 1);
+        if (size == 0 || offset + size > regionEnd)
+            return range;
+        if (!map())
+            return range;
+        range.buffer = buffer;
+        range.offset = offset;
+        range.size = size;
+        range.data = persistentMapping ? persistentMapping + offset : mapping + (offset - flushed);
+        cursor = offset + size;
+        streamed += size;
+        return range;
+    }
+    StreamRange write(const void *data, size_t size, size_t alignment = 4)
+    {
+        StreamRange range = allocate(size, alignment);
+        if (range.valid())
+            memcpy(range.data, data, size);
+        return range;
+    }
+    // make what this frame wrote visible to GL; draws reading it come after
+    void flush()
+    {
+        if (!mapping)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (cursor > flushed)
+            glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, (GLsizeiptr)(cursor - flushed));
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mapping = nullptr;
+        flushed = cursor; // allocations after a flush map the rest of the region
+    }
+
+    unsigned int id() const { return buffer; }
+    bool persistent() const { return persistentMapping != nullptr; }
+    // bytes handed out by allocate() since the last resetCounters()
+    unsigned long long bytesStreamed() const { return streamed; }
+    // times beginFrame() had to wait for the GPU
+    unsigned long long fenceWaits() const { return waits; }
+    void resetCounters()
+    {
+        streamed = 0;
+        waits = 0;
+    }
+
+private:
+    unsigned int buffer = 0;
+    int frames;
+    size_t regionSize;
+    unsigned char *persistentMapping = nullptr;
+    unsigned char *mapping = nullptr; // the unsynchronized mapping, from flushed on
+    std::vector<GLsync> fences;
+    int region = 0;
+    bool started = false;
+    size_t cursor, flushed, regionEnd;
+    unsigned long long streamed = 0;
+    unsigned long long waits = 0;
+
+    // the unsynchronized mapping covers flushed .. regionEnd
+    bool map()
+    {
+        if (persistentMapping)
+            return true;
+        if (!mapping)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            mapping = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)flushed,
+                                                        (GLsizeiptr)(regionEnd - flushed), flags);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        return mapping != nullptr;
+    }
+};
+#endif
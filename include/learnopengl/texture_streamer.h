@@ -0,0 +1,442 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iostream>
+
+// loads textures without stalling the frame: worker threads read and decode
+// the images straight into mapped pixel buffer objects from a small pool,
+// and update(), called once per frame on the GL thread, only moves pixels
+// from a PBO into its texture with glTexSubImage2D, a band of rows at a time
+// up to a budget of bytes per frame. a large image takes a few frames to
+// appear instead of making one frame long.
+//
+// load() returns the texture straight away; it stays empty (samples as
+// black) until it is ready(). set its wrap and filter parameters as usual.
+//
+//   TextureStreamer streamer(4.0);           // 4 MB per frame
+//   unsigned int texture = streamer.load(path, 4);
+//   // every frame:
+//   streamer.update();
+class TextureStreamer
+{
+public:
+    explicit TextureStreamer(double megabytesPerFrame = 4.0, size_t threads = 2, size_t pboCount = 4)
+        : pool(pboCount ? pboCount : 1)
+    {
+        setBudget(megabytesPerFrame);
+        for (Buffer &buffer : pool)
+            glGenBuffers(1, &buffer.id);
+        for (size_t i = 0; i < (threads ? threads : 1); ++i)
+            workers.emplace_back(&TextureStreamer::workerMain, this);
+    }
+    ~TextureStreamer()
+    {
+        clear();
+    }
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    void setBudget(double megabytesPerFrame)
+    {
+        budget = (size_t)(megabytesPerFrame * 1024 * 1024);
+    }
+
+    // start loading an image file into a new GL_TEXTURE_2D. channels is 3
+    // (RGB) or 4 (RGBA); flip turns the image upside down, as OpenGL's
+    // texture origin is the bottom left. mipmaps are generated once the
+    // image is in, and only if the texture's min filter samples them then;
+    // they count against the budget as a third of the image. returns 0
+    // after clear(), as nothing would load the texture any more
+    unsigned int load(const std::string &path, int channels, bool mipmaps = true, bool flip = true)
+    {
+        // only the GL thread writes stopping, and it is the one calling load()
+        if (stopping)
+            return 0;
+        std::unique_ptr<Job> job(new Job);
+        glGenTextures(1, &job->texture);
+        job->path = path;
+        job->channels = channels;
+        job->mipmaps = mipmaps;
+        job->flip = flip;
+        job->start = std::chrono::steady_clock::now();
+        unsigned int texture = job->texture;
+        ++outstanding;
+        queue(std::move(job));
+        return texture;
+    }
+
+    // GL thread, once per frame: give decoded images buffers to decode into
+    // and upload at most the budget. returns the number of textures that
+    // became ready
+    size_t update()
+    {
+        size_t finished = 0;
+        frameBytes = 0;
+        ++frame;
+        std::deque<std::unique_ptr<Job>> arrived;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            arrived.swap(done);
+        }
+        for (auto &job : arrived)
+        {
+            if (job->stage == Stage::Sized)
+                waiting.push_back(std::move(job));
+            else
+                uploading.push_back(std::move(job));
+        }
+
+        // images whose size is known: map a free buffer and let a worker decode into it
+        while (!waiting.empty())
+        {
+            Job &job = *waiting.front();
+            if (job.failed)
+            {
+                fail(job);
+                waiting.pop_front();
+                continue;
+            }
+            Buffer *buffer = freeBuffer();
+            if (!buffer)
+                break;
+            if (!map(*buffer, job.size))
+            {
+                fail(job);
+                waiting.pop_front();
+                continue;
+            }
+            job.buffer = buffer;
+            job.pixels = buffer->mapped;
+            job.stage = Stage::Decode;
+            queue(std::move(waiting.front()));
+            waiting.pop_front();
+        }
+
+        // decoded images: upload rows until the budget is spent. a frame
+        // always gets at least one band in, so a budget smaller than a row
+        // still makes progress
+        while (!uploading.empty())
+        {
+            Job &job = *uploading.front();
+            if (job.failed)
+            {
+                release(*job.buffer, false);
+                fail(job);
+                uploading.pop_front();
+                continue;
+            }
+            if (frameBytes >= budget && frameBytes > 0)
+                break;
+            if (job.row < job.height)
+            {
+                upload(job);
+                if (job.row < job.height)
+                    break;
+            }
+            if (job.mipmaps)
+            {
+                bindTexture(job.texture);
+                // the smaller levels add up to about a third of the image
+                size_t mipmapBytes = job.size / 3;
+                if (!usesMipmaps())
+                    job.mipmaps = false;
+                else if (frameBytes > 0 && frameBytes + mipmapBytes > budget)
+                    break;
+                else
+                {
+                    glGenerateMipmap(GL_TEXTURE_2D);
+                    frameBytes += mipmapBytes;
+                }
+            }
+            release(*job.buffer, true);
+            Loaded entry;
+            entry.texture = job.texture;
+            entry.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.start).count();
+            entry.frames = frame - job.firstFrame + 1;
+            loaded.push_back(entry);
+            ++finished;
+            --outstanding;
+            uploading.pop_front();
+        }
+        // leave the active unit's texture as the caller (or its RenderState) had it
+        if (previousTexture >= 0)
+        {
+            glBindTexture(GL_TEXTURE_2D, (unsigned int)previousTexture);
+            previousTexture = -1;
+        }
+        uploaded += frameBytes;
+        if (frameBytes > maxFrameBytes)
+            maxFrameBytes = frameBytes;
+        return finished;
+    }
+    // update() until every texture is in, ignoring the frame budget
+    void finish()
+    {
+        size_t saved = budget;
+        budget = (size_t)-1;
+        while (outstanding > 0)
+        {
+            update();
+            if (outstanding > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        budget = saved;
+    }
+
+    // stop the workers and delete the buffers; textures still loading stay
+    // empty, and later load()s fail. call it while the context is still
+    // alive if the streamer outlives it
+    void clear()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+        workers.clear();
+        for (Buffer &buffer : pool)
+        {
+            unmap(buffer);
+            if (buffer.fence)
+                glDeleteSync(buffer.fence);
+            glDeleteBuffers(1, &buffer.id);
+        }
+        pool.clear();
+        queued.clear();
+        done.clear();
+        waiting.clear();
+        uploading.clear();
+        outstanding = 0;
+    }
+
+    bool ready(unsigned int texture) const
+    {
+        return find(texture) != nullptr;
+    }
+    // how long a ready texture took from load() until it was in, in
+    // milliseconds and in frames; 0 while it is still loading
+    double loadMilliseconds(unsigned int texture) const
+    {
+        const Loaded *t = find(texture);
+        return t ? t->milliseconds : 0.0;
+    }
+    unsigned long long loadFrames(unsigned int texture) const
+    {
+        const Loaded *t = find(texture);
+        return t ? t->frames : 0;
+    }
+    // textures still loading
+    size_t pending() const { return outstanding; }
+    // bytes update() moved from PBOs into textures, in all and at most in one frame
+    unsigned long long bytesUploaded() const { return uploaded; }
+    size_t peakFrameBytes() const { return maxFrameBytes; }
+
+private:
+    enum class Stage
+    {
+        Info,   // worker: read the size
+        Sized,  // GL thread: waiting for a buffer
+        Decode, // worker: decode into the mapped buffer
+        Upload  // GL thread: upload rows
+    };
+    struct Buffer
+    {
+        unsigned int id = 0;
+        size_t capacity = 0;
+        unsigned char *mapped = nullptr;
+        GLsync fence = nullptr; // the last upload from it
+        bool busy = false;
+    };
+    struct Job
+    {
+        std::string path;
+        unsigned int texture = 0;
+        int channels = 4;
+        bool mipmaps = true, flip = true, failed = false;
+        Stage stage = Stage::Info;
+        int width = 0, height = 0, stride = 0, row = 0;
+        size_t size = 0;
+        Buffer *buffer = nullptr;
+        unsigned char *pixels = nullptr; // the buffer's mapping, written by the worker
+        std::chrono::steady_clock::time_point start;
+        unsigned long long firstFrame = 0;
+    };
+    struct Loaded
+    {
+        unsigned int texture = 0;
+        double milliseconds = 0.0;
+        unsigned long long frames = 0;
+    };
+
+    std::vector<Buffer> pool;
+    std::deque<std::unique_ptr<Job>> waiting, uploading; // GL thread only
+    std::vector<Loaded> loaded;
+    size_t budget = 0, frameBytes = 0, maxFrameBytes = 0, outstanding = 0;
+    unsigned long long uploaded = 0, frame = 0;
+    int previousTexture = -1; // bound before update() started binding, -1 if untouched
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::unique_ptr<Job>> queued, done;
+    bool stopping = false;
+
+    void bindTexture(unsigned int texture)
+    {
+        if (previousTexture < 0)
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+    const Loaded *find(unsigned int texture) const
+    {
+        for (const Loaded &t : loaded)
+        {
+            if (t.texture == texture)
+                return &t;
+        }
+        return nullptr;
+    }
+    // whether the bound texture's min filter reads other levels than the base
+    static bool usesMipmaps()
+    {
+        int filter = 0;
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &filter);
+        return filter != GL_NEAREST && filter != GL_LINEAR;
+    }
+    void queue(std::unique_ptr<Job> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+    void fail(Job &job)
+    {
+        std::cout << "ERROR::TEXTURE_STREAMER::LOAD_FAILED: " << job.path << std::endl;
+        --outstanding;
+    }
+    // a buffer no upload is still reading from
+    Buffer *freeBuffer()
+    {
+        for (Buffer &buffer : pool)
+        {
+            if (buffer.busy)
+                continue;
+            if (buffer.fence)
+            {
+                if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                    continue;
+                glDeleteSync(buffer.fence);
+                buffer.fence = nullptr;
+            }
+            return &buffer;
+        }
+        return nullptr;
+    }
+    bool map(Buffer &buffer, size_t size)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+        if (size > buffer.capacity)
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+            buffer.capacity = size;
+        }
+        buffer.mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size,
+                                                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        buffer.busy = buffer.mapped != nullptr;
+        return buffer.busy;
+    }
+    void unmap(Buffer &buffer)
+    {
+        if (!buffer.mapped)
+            return;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        buffer.mapped = nullptr;
+    }
+    void release(Buffer &buffer, bool read)
+    {
+        unmap(buffer);
+        if (read)
+            buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        buffer.busy = false;
+    }
+    void upload(Job &job)
+    {
+        GLenum format = job.channels == 4 ? GL_RGBA : GL_RGB;
+        bindTexture(job.texture);
+        if (job.stage != Stage::Upload)
+        {
+            job.stage = Stage::Upload;
+            job.firstFrame = frame;
+            unmap(*job.buffer);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, job.width, job.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        }
+        size_t left = budget > frameBytes ? budget - frameBytes : 0;
+        int rows = (int)(left / (size_t)job.stride);
+        if (rows < 1)
+            rows = 1;
+        if (rows > job.height - job.row)
+            rows = job.height - job.row;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.buffer->id);
+        // with a PBO bound the last argument is an offset into it
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.row, job.width, rows, format, GL_UNSIGNED_BYTE,
+                        (void *)((size_t)job.row * job.stride));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        job.row += rows;
+        frameBytes += (size_t)rows * job.stride;
+    }
+
+    void workerMain()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this] { return stopping || !queued.empty(); });
+            if (stopping)
+                break;
+            std::unique_ptr<Job> job = std::move(queued.front());
+            queued.pop_front();
+            lock.unlock();
+            if (job->stage == Stage::Info)
+            {
+                int components;
+                if (stbi_info(job->path.c_str(), &job->width, &job->height, &components) && job->width > 0 && job->height > 0)
+                {
+                    // rows aligned like the default GL_UNPACK_ALIGNMENT of 4
+                    job->stride = (job->width * job->channels + 3) & ~3;
+                    job->size = (size_t)job->stride * (job->height - 1) + (size_t)job->width * job->channels;
+                }
+                else
+                    job->failed = true;
+                job->stage = Stage::Sized;
+            }
+            else
+            {
+                int width, height, components;
+                if (!stbi_load_into(job->path.c_str(), job->pixels, job->size, job->stride, &width, &height,
+                                    &components, job->channels, job->flip ? 1 : 0))
+                    job->failed = true;
+            }
+            lock.lock();
+            done.push_back(std::move(job));
+        }
+    }
+};
+#endif
@@ -0,0 +1,147 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <learnopengl/stream_buffer.h>
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+// writes values one after the other with the std140 layout rules, so that
+// they line up with a `layout(std140) uniform Block { ... };` declaring the
+// same members in the same order:
+//   float/int/bool  4 bytes, 4-byte aligned
+//   vec2            8 bytes, 8-byte aligned
+//   vec3, vec4      12 / 16 bytes, 16-byte aligned
+//   mat3, mat4      3 / 4 columns of vec4, column-major like glUniformMatrix*
+//   arrays          every element on its own 16 bytes (so float[] wastes 12)
+//   structs         start and end on 16 bytes, see beginStruct/endStruct
+// writing past the capacity is dropped and makes overflow() true
+class Std140Writer
+{
+public:
+    Std140Writer(void *data = nullptr, size_t capacity = 0)
+        : data((unsigned char *)data), capacity(capacity)
+    {
+    }
+    Std140Writer &putFloat(float value) { return put(&value, 4, 4); }
+    Std140Writer &putInt(int value) { return put(&value, 4, 4); }
+    Std140Writer &putBool(bool value) { return putInt(value ? 1 : 0); }
+    Std140Writer &putVec2(const float *value) { return put(value, 8, 8); }
+    Std140Writer &putVec3(const float *value) { return put(value, 12, 16); }
+    Std140Writer &putVec4(const float *value) { return put(value, 16, 16); }
+    Std140Writer &putMat3(const float *value)
+    {
+        for (int column = 0; column < 3; ++column)
+            put(value + column * 3, 12, 16);
+        return align(16);
+    }
+    Std140Writer &putMat4(const float *value) { return put(value, 64, 16); }
+    Std140Writer &putFloatArray(const float *values, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            put(values + i, 4, 16);
+        return align(16);
+    }
+    Std140Writer &putVec4Array(const float *values, size_t count) { return put(values, count * 16, 16); }
+    Std140Writer &putMat4Array(const float *values, size_t count) { return put(values, count * 64, 16); }
+    Std140Writer &beginStruct() { return align(16); }
+    Std140Writer &endStruct() { return align(16); }
+    // leave a member as it is
+    Std140Writer &skip(size_t size, size_t alignment) { return put(nullptr, size, alignment); }
+
+    size_t offset() const { return cursor; }
+    bool overflow() const { return cursor > capacity; }
+
+private:
+    unsigned char *data;
+    size_t capacity;
+    size_t cursor = 0;
+
+    Std140Writer &align(size_t alignment)
+    {
+        cursor = (cursor + alignment - 1) & ~(alignment - 1);
+        return *this;
+    }
+    Std140Writer &put(const void *value, size_t size, size_t alignment)
+    {
+        align(alignment);
+        if (value && cursor + size <= capacity)
+            memcpy(data + cursor, value, size);
+        cursor += size;
+        return *this;
+    }
+};
+
+// part of a UniformRing that holds one block's data for this frame
+struct UniformRange
+{
+    unsigned int buffer = 0;
+    size_t offset = 0, size = 0;
+    unsigned char *data = nullptr;
+
+    bool valid() const { return data != nullptr; }
+    Std140Writer writer() const { return Std140Writer(data, size); }
+    // attach to the binding point a Shader bound its block to
+    void bind(unsigned int binding) const
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, (GLintptr)offset, (GLsizeiptr)size);
+    }
+};
+
+// one uniform buffer for all the uniform data of a frame: per-frame values
+// and per-object values alike are allocated from it and written with a
+// Std140Writer, and the whole frame goes to GL in a single update instead of
+// a glUniform* call per value. the ring, its fences and its mapping are a
+// StreamBuffer's; this only keeps ranges on GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+//
+//   ring.beginFrame();
+//   UniformRange frame = ring.allocate(shader.uniformBlockSize("Frame"));
+//   frame.writer().putMat4(view).putMat4(projection).putFloat(time);
+//   ... allocate and write per-object ranges ...
+//   ring.flush();   // before the draws
+//   frame.bind(0);  // shader.bindUniformBlock("Frame", 0) once
+class UniformRing
+{
+public:
+    explicit UniformRing(size_t bytesPerFrame, int frames = 3)
+        : offsetAlignment(queryAlignment()),
+          ring((bytesPerFrame + offsetAlignment - 1) / offsetAlignment * offsetAlignment, frames)
+    {
+    }
+
+    // move on to the next region, once the GPU is done reading it
+    void beginFrame() { ring.beginFrame(); }
+    // room for size bytes of this frame; invalid if the frame is full
+    UniformRange allocate(size_t size)
+    {
+        StreamRange stream = ring.allocate(size, offsetAlignment);
+        UniformRange range;
+        range.buffer = stream.buffer;
+        range.offset = stream.offset;
+        range.size = stream.size;
+        range.data = stream.data;
+        return range;
+    }
+    // make what this frame wrote visible to GL
+    void flush() { ring.flush(); }
+
+    unsigned int id() const { return ring.id(); }
+    bool persistent() const { return ring.persistent(); }
+    // times beginFrame() had to wait for the GPU
+    unsigned long long fenceWaits() const { return ring.fenceWaits(); }
+    unsigned long long bytesStreamed() const { return ring.bytesStreamed(); }
+
+private:
+    size_t offsetAlignment;
+    StreamBuffer ring;
+
+    static size_t queryAlignment()
+    {
+        int alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return alignment > 0 ? (size_t)alignment : 256;
+    }
+};
+#endif
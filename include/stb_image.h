@@ -37,7 +37,7 @@ http://gist.github.com/urraka/685d9a6340b26b830d49
 
 - decode from memory or through FILE (define STBI_NO_STDIO to remove code)
 - decode from arbitrary I/O callbacks
-- SIMD acceleration on x86/x64 (SSE2) and ARM (NEON)
+- SIMD acceleration on x86/x64 (SSE2, AVX2) and ARM (NEON)
 
 Full documentation under "DOCUMENTATION" below.
 
@@ -312,6 +312,15 @@ publish, and distribute this file as you see fit.
 // (at least this is true for iOS and Android). Therefore, the NEON support is
 // toggled by a build flag: define STBI_NEON to get NEON loops.
 //
+// PNG unfiltering of 8-bit RGB/RGBA rows also uses SSE2 when available.
+//
+// On x86 compilers that support per-function target attributes (GCC 4.9+,
+// Clang, VC++ 2012+), AVX2 versions of the IDCT, YCbCr->RGB and 2x2
+// upsampling kernels are compiled in as well and picked at run-time when the
+// CPU supports them; the rest of the file does not need -mavx2. They produce
+// bit-identical output to the SSE2 kernels. Define STBI_NO_AVX2 to leave them
+// out.
+//
 // The output of the JPEG decoder is slightly different from versions where
 // SIMD support was introduced (that is, for versions before 1.49). The
 // difference is only +-1 in the 8-bit RGB channels, and only on a small
@@ -325,6 +334,99 @@ publish, and distribute this file as you see fit.
 //
 // ===========================================================================
 //
+// Multithreaded decoding
+//
+// stbi_load_parallel() and stbi_load_from_memory_parallel() take a thread
+// count. Baseline JPEGs written with restart markers (e.g. cjpeg -restart)
+// are split at the RSTn markers and each group of restart intervals is
+// Huffman-decoded and IDCT'd on its own thread; files without restart
+// markers are entropy-decoded serially. Upsampling and color conversion are
+// split into horizontal bands for every JPEG. For non-interlaced PNGs,
+// zlib inflate runs on a second thread and the calling thread unfilters
+// each row as soon as it has been inflated. Threads are created per call
+// (pthreads, or Win32 threads on Windows); define STBI_NO_THREADS to compile
+// all of this out, in which case the _parallel functions decode serially.
+//
+// ===========================================================================
+//
+// Memory-mapped loading
+//
+// stbi_load_mapped() maps the file read-only (mmap, or MapViewOfFile on
+// Windows), hints the OS that it will be read sequentially, and decodes
+// directly from the mapping, so the compressed bytes are never copied into
+// a stdio buffer. stbi_load_parallel() reads its input the same way. If the
+// file can't be mapped (empty file, pipe, unsupported platform) it is read
+// into memory instead; define STBI_NO_MMAP to always do that.
+//
+// ===========================================================================
+//
+// Arena allocation
+//
+// By default every buffer stb_image needs (component planes, zlib output,
+// format conversion, the result itself) comes from STBI_MALLOC. To keep a
+// batch of loads off the shared heap, give each loading thread an arena:
+//
+//     stbi_arena arena;
+//     stbi_arena_init(&arena, memory, memory_size);
+//     stbi_set_thread_arena(&arena);
+//     for (each file) {
+//         data = stbi_load(...);        // NULL with "outofmem" if the arena is full
+//         upload(data);                 // arena.peak / arena.total describe this load
+//         stbi_arena_reset(&arena);     // releases data and every temporary at once
+//     }
+//     stbi_set_thread_arena(NULL);
+//
+// The arena is a bump allocator: freeing only gives memory back if it is the
+// newest block, and reallocating any other block copies it. Results from an
+// arena must not outlive the next reset, and stbi_image_free() on them is a
+// no-op only while that arena is current on the calling thread. The arena
+// is per thread (thread_local/__thread where available); the worker threads
+// of the _parallel functions never allocate, so they don't need one.
+//
+// ===========================================================================
+//
+// Progressive JPEG streaming
+//
+// stbi_load() needs the whole file before it produces anything, and a
+// progressive JPEG only turns into pixels after its last scan. To show a
+// large asset while it is still downloading or being read, feed it to a
+// stream as it arrives:
+//
+//     stbi_jpeg_stream *js = stbi_jpeg_stream_begin(&options); // or NULL
+//     while (more data) {
+//         int r = stbi_jpeg_stream_feed(js, chunk, chunk_len);
+//         if (r == STBI_stream_error) break;
+//         if (r != STBI_stream_more) {
+//             data = stbi_jpeg_stream_image(js, &x, &y, &n, &scale);
+//             upload(data, x, y);       // x, y are the full size divided by scale
+//             stbi_image_free(data);
+//         }
+//         if (r == STBI_stream_done) break;
+//     }
+//     stbi_jpeg_stream_end(js);
+//
+// Each scan is decoded as soon as all of it has arrived. Once the first DC
+// scan is in, stbi_jpeg_stream_image() returns a 1/8-scale preview made
+// from the block averages, which costs no IDCT or upsampling at full size;
+// after the first AC scan it returns full-size images that sharpen with
+// every further scan. Baseline JPEGs have nothing to show until they are
+// done. The stream holds on to the unconsumed bytes only, plus the
+// coefficients of a progressive image.
+//
+// ===========================================================================
+//
+// Scaled JPEG decoding
+//
+// For thumbnails and mip levels, set stbi_load_options.jpeg_scale to 2, 4
+// or 8. Each 8x8 block is then written as the 4x4 or 2x2 average of its
+// pixels, or as its DC term alone, and upsampling and color conversion run
+// on the smaller planes. A 1/8 decode of a progressive JPEG skips the AC
+// scans entirely. The result is ceil(width/scale) x ceil(height/scale);
+// stbi_info_ex() with the same options reports that size up front. Other
+// formats ignore jpeg_scale and load at full size.
+//
+// ===========================================================================
+//
 // HDR image support   (disable by defining STBI_NO_HDR)
 //
 // stb_image now supports loading HDR images in general, and currently
@@ -379,6 +481,7 @@ publish, and distribute this file as you see fit.
 #ifndef STBI_NO_STDIO
 #include <stdio.h>
 #endif // STBI_NO_STDIO
+#include <stddef.h> // size_t
 
 #define STBI_VERSION 1
 
@@ -435,6 +538,30 @@ extern "C" {
     // for stbi_load_from_file, file pointer is left pointing immediately after image
 #endif
 
+    // same as above, but may use up to 'num_threads' threads (<= 0 means one
+    // per CPU core). baseline JPEGs with restart markers are entropy-decoded in
+    // parallel slices; JPEG upsampling and color conversion are split by rows.
+    // everything else decodes exactly like stbi_load.
+    STBIDEF stbi_uc *stbi_load_from_memory_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels, int num_threads);
+#ifndef STBI_NO_STDIO
+    STBIDEF stbi_uc *stbi_load_parallel(char const *filename, int *x, int *y, int *channels_in_file, int desired_channels, int num_threads);
+
+    // same as stbi_load, but decodes straight out of a read-only memory mapping
+    // of the file instead of copying it through stdio (see "Memory-mapped loading")
+    STBIDEF stbi_uc *stbi_load_mapped(char const *filename, int *x, int *y, int *channels_in_file, int desired_channels);
+#endif
+
+    // decode into caller memory (e.g. a mapped pixel buffer object) instead of
+    // a new allocation. row j of the image goes to dst + j*stride, or to row
+    // h-1-j if 'flip' is set (stbi_set_flip_vertically_on_load is ignored).
+    // size dst with stbi_info: it needs (h-1)*stride + w*channels bytes, where
+    // channels is desired_channels, or the file's if that is 0. returns 1 on
+    // success; on failure dst may have been partly written.
+    STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *dst, size_t dst_size, int stride, int *x, int *y, int *channels_in_file, int desired_channels, int flip);
+#ifndef STBI_NO_STDIO
+    STBIDEF int stbi_load_into(char const *filename, stbi_uc *dst, size_t dst_size, int stride, int *x, int *y, int *channels_in_file, int desired_channels, int flip);
+#endif
+
     ////////////////////////////////////
     //
     // 16-bits-per-channel interface
@@ -479,20 +606,82 @@ extern "C" {
 #endif // STBI_NO_STDIO
 
 
-    // get a VERY brief reason for failure
-    // NOT THREADSAFE
+    // get a VERY brief reason for failure on the calling thread (process-wide
+    // if the compiler has no thread-local storage)
     STBIDEF const char *stbi_failure_reason(void);
 
-    // free the loaded image -- this is just free()
+    // free the loaded image -- this is just free(), or a no-op for memory
+    // that came from the calling thread's arena
     STBIDEF void     stbi_image_free(void *retval_from_stbi_load);
 
+    // bump allocator over caller-owned memory (see "Arena allocation")
+    typedef struct
+    {
+        stbi_uc *base;
+        size_t size;   // usable bytes at base
+        size_t used;   // bytes handed out so far, including block headers and padding
+        size_t last;   // offset of the newest block, which can be grown or released in place
+        size_t peak;   // highest 'used' since the last reset
+        size_t total;  // bytes requested since the last reset
+        int count;     // allocations since the last reset
+    } stbi_arena;
+
+    STBIDEF void        stbi_arena_init(stbi_arena *arena, void *memory, size_t size);
+    STBIDEF void        stbi_arena_reset(stbi_arena *arena);
+    // route this thread's stb_image allocations through 'arena' (NULL: back to
+    // STBI_MALLOC/STBI_FREE). returns the previous arena.
+    STBIDEF stbi_arena *stbi_set_thread_arena(stbi_arena *arena);
+
+    // per-call settings for the *_ex loaders. a zeroed struct (or a NULL
+    // pointer) behaves like stbi_load with the stbi_set_* globals left at
+    // their defaults; unlike those globals, these can differ between threads
+    // that decode at the same time.
+    typedef struct
+    {
+        int desired_channels; // as in stbi_load: 0 keeps the file's channel count
+        int flip_vertically;  // see stbi_set_flip_vertically_on_load
+        int unpremultiply;    // see stbi_set_unpremultiply_on_load
+        stbi_arena *arena;    // allocate from this for the call; NULL keeps the thread's arena (if any)
+        int jpeg_scale;       // 2, 4 or 8 decodes JPEGs at that fraction of their size;
+                              // 0 or 1 is full size. other formats ignore it
+    } stbi_load_options;
+
+    STBIDEF stbi_uc *stbi_load_from_memory_ex(stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, stbi_load_options const *options);
+    STBIDEF stbi_uc *stbi_load_from_callbacks_ex(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *channels_in_file, stbi_load_options const *options);
+#ifndef STBI_NO_STDIO
+    STBIDEF stbi_uc *stbi_load_ex(char const *filename, int *x, int *y, int *channels_in_file, stbi_load_options const *options);
+#endif
+
+    // JPEG decoding from data that arrives in pieces (see "Progressive JPEG
+    // streaming"). stbi_jpeg_stream_feed returns one of these:
+    enum
+    {
+        STBI_stream_error = -1,
+        STBI_stream_more = 0,    // nothing new to show yet
+        STBI_stream_updated = 1, // a scan finished; stbi_jpeg_stream_image has a better picture
+        STBI_stream_done = 2     // the whole image has arrived
+    };
+
+    typedef struct stbi_jpeg_stream stbi_jpeg_stream;
+
+    // options->arena and jpeg_scale are ignored; the stream's own buffers always
+    // come from the heap
+    STBIDEF stbi_jpeg_stream *stbi_jpeg_stream_begin(stbi_load_options const *options);
+    STBIDEF int               stbi_jpeg_stream_feed(stbi_jpeg_stream *stream, stbi_uc const *data, int len);
+    // the picture so far, as a new image; *scale is 8 for the DC-only preview, 1 at full size
+    STBIDEF stbi_uc          *stbi_jpeg_stream_image(stbi_jpeg_stream *stream, int *x, int *y, int *channels_in_file, int *scale);
+    STBIDEF void              stbi_jpeg_stream_end(stbi_jpeg_stream *stream);
+
     // get image dimensions & components without fully decoding
     STBIDEF int      stbi_info_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp);
     STBIDEF int      stbi_info_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp);
+    // the size the *_ex loaders would return with these options (e.g. a scaled JPEG's)
+    STBIDEF int      stbi_info_from_memory_ex(stbi_uc const *buffer, int len, int *x, int *y, int *comp, stbi_load_options const *options);
 
 #ifndef STBI_NO_STDIO
     STBIDEF int      stbi_info(char const *filename, int *x, int *y, int *comp);
     STBIDEF int      stbi_info_from_file(FILE *f, int *x, int *y, int *comp);
+    STBIDEF int      stbi_info_ex(char const *filename, int *x, int *y, int *comp, stbi_load_options const *options);
 
 #endif
 
@@ -507,7 +696,9 @@ extern "C" {
     // or just pass them through "as-is"
     STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 
-    // flip the image vertically, so the first pixel in the output array is the bottom left
+    // flip the image vertically, so the first pixel in the output array is the bottom left.
+    // this and stbi_set_unpremultiply_on_load are process-wide; use stbi_load_options
+    // for loads on several threads that need different settings
     STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
     // ZLIB client - used by PNG, available for other purposes
@@ -748,6 +939,286 @@ static int stbi__sse2_available()
 #define STBI_SIMD_ALIGN(type, name) type name
 #endif
 
+// AVX2: only the kernels are compiled for AVX2, via a target attribute
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2)
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ * 100 + __GNUC_MINOR__) >= 409)
+#define STBI_AVX2
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define STBI_AVX2
+#define STBI__AVX2_TARGET
+#endif
+#endif
+
+#ifdef STBI_AVX2
+#include <immintrin.h>
+
+// only the JPEG kernels have AVX2 versions
+#ifndef STBI_NO_JPEG
+#ifdef _MSC_VER
+static int stbi__avx2_available(void)
+{
+    int info[4];
+    __cpuid(info, 1);
+    // need OSXSAVE + AVX, and the OS has to save the YMM state
+    if ((info[2] & (3 << 27)) != (3 << 27))
+        return 0;
+    if ((_xgetbv(0) & 6) != 6)
+        return 0;
+    __cpuidex(info, 7, 0);
+    return ((info[1] >> 5) & 1) != 0;
+}
+#else
+static int stbi__avx2_available(void)
+{
+    // also checks that the OS saves the YMM state
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif // !STBI_NO_JPEG
+#endif
+
+#ifndef STBI_THREAD_LOCAL
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define STBI_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define STBI_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define STBI_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define STBI_THREAD_LOCAL __thread
+#else
+#define STBI_THREAD_LOCAL // no thread-local storage: one failure reason and arena for the whole process
+#endif
+#endif
+
+// per thread, so decodes on different threads don't trample each other's
+static STBI_THREAD_LOCAL const char *stbi__g_failure_reason;
+
+///////////////////////////////////////////////
+//
+//  minimal fork/join threading for the *_parallel entry points, plus a
+//  progress counter for pipelining two stages of one decode
+//
+//  define STBI_NO_THREADS to compile this out; the *_parallel functions
+//  then decode on the calling thread.
+
+#ifndef STBI_NO_THREADS
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef HANDLE stbi__thread;
+#else
+#include <pthread.h>
+#include <unistd.h> // sysconf
+typedef pthread_t stbi__thread;
+#endif
+
+#define STBI__MAX_THREADS 64
+
+#ifdef _WIN32
+static int stbi__cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+#else
+static int stbi__cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+#endif
+
+static int stbi__clamp_threads(int num_threads)
+{
+    if (num_threads <= 0) num_threads = stbi__cpu_count();
+    if (num_threads > STBI__MAX_THREADS) num_threads = STBI__MAX_THREADS;
+    return num_threads;
+}
+
+// only the JPEG and PNG decoders start threads
+#if !defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)
+// a job runs once per thread; 'index' is in [0,count), returns 0 on failure
+typedef int (*stbi__thread_func)(void *job, int index, int count);
+
+typedef struct
+{
+    stbi__thread_func func;
+    void *job;
+    int index, count, result;
+    const char *failure_reason; // the worker thread's, if result is 0
+} stbi__worker;
+
+#ifdef _WIN32
+static DWORD WINAPI stbi__worker_main(LPVOID p)
+{
+    stbi__worker *w = (stbi__worker *)p;
+    w->result = w->func(w->job, w->index, w->count);
+    w->failure_reason = stbi__g_failure_reason;
+    return 0;
+}
+
+static int stbi__thread_start(stbi__thread *t, stbi__worker *w)
+{
+    *t = CreateThread(NULL, 0, stbi__worker_main, w, 0, NULL);
+    return *t != NULL;
+}
+
+static void stbi__thread_join(stbi__thread t)
+{
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+#else
+static void *stbi__worker_main(void *p)
+{
+    stbi__worker *w = (stbi__worker *)p;
+    w->result = w->func(w->job, w->index, w->count);
+    w->failure_reason = stbi__g_failure_reason;
+    return NULL;
+}
+
+static int stbi__thread_start(stbi__thread *t, stbi__worker *w)
+{
+    return pthread_create(t, NULL, stbi__worker_main, w) == 0;
+}
+
+static void stbi__thread_join(stbi__thread t)
+{
+    pthread_join(t, NULL);
+}
+#endif
+#endif
+
+#ifndef STBI_NO_JPEG
+// run func(job, i, count) for every i in [0,count), index 0 on the calling
+// thread. if a thread can't be started its share runs on the calling thread.
+static int stbi__run_workers(stbi__thread_func func, void *job, int count)
+{
+    stbi__worker w[STBI__MAX_THREADS];
+    stbi__thread t[STBI__MAX_THREADS];
+    int started[STBI__MAX_THREADS];
+    int i, ok = 1;
+    STBI_ASSERT(count >= 1 && count <= STBI__MAX_THREADS);
+    for (i = 0; i < count; ++i) {
+        w[i].func = func;
+        w[i].job = job;
+        w[i].index = i;
+        w[i].count = count;
+        w[i].result = 0;
+        started[i] = i > 0 && stbi__thread_start(&t[i], &w[i]);
+    }
+    w[0].result = func(job, 0, count);
+    for (i = 1; i < count; ++i) {
+        if (started[i]) stbi__thread_join(t[i]);
+        else w[i].result = func(job, i, count);
+    }
+    for (i = 0; i < count; ++i) {
+        if (!w[i].result && ok && i > 0 && started[i])
+            stbi__g_failure_reason = w[i].failure_reason;
+        ok &= w[i].result != 0;
+    }
+    return ok;
+}
+#endif
+
+#ifndef STBI_NO_PNG
+// a counter that one thread advances and another waits on, for pipelining
+// a producer (e.g. inflate) with a consumer (e.g. PNG unfiltering)
+typedef struct
+{
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE cond;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+    stbi__uint32 value;
+    int done;
+} stbi__progress;
+
+#ifdef _WIN32
+static void stbi__progress_init(stbi__progress *p)
+{
+    InitializeCriticalSection(&p->lock);
+    InitializeConditionVariable(&p->cond);
+    p->value = 0;
+    p->done = 0;
+}
+
+static void stbi__progress_free(stbi__progress *p)
+{
+    DeleteCriticalSection(&p->lock);
+}
+
+static void stbi__progress_set(stbi__progress *p, stbi__uint32 value, int done)
+{
+    EnterCriticalSection(&p->lock);
+    p->value = value;
+    p->done = done;
+    LeaveCriticalSection(&p->lock);
+    WakeAllConditionVariable(&p->cond);
+}
+
+// wait until at least 'target' has been published; returns 0 if the
+// producer finished without getting there
+static int stbi__progress_wait(stbi__progress *p, stbi__uint32 target)
+{
+    int ok;
+    EnterCriticalSection(&p->lock);
+    while (p->value < target && !p->done)
+        SleepConditionVariableCS(&p->cond, &p->lock, INFINITE);
+    ok = p->value >= target;
+    LeaveCriticalSection(&p->lock);
+    return ok;
+}
+#else
+static void stbi__progress_init(stbi__progress *p)
+{
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    p->value = 0;
+    p->done = 0;
+}
+
+static void stbi__progress_free(stbi__progress *p)
+{
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+}
+
+static void stbi__progress_set(stbi__progress *p, stbi__uint32 value, int done)
+{
+    pthread_mutex_lock(&p->lock);
+    p->value = value;
+    p->done = done;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// wait until at least 'target' has been published; returns 0 if the
+// producer finished without getting there
+static int stbi__progress_wait(stbi__progress *p, stbi__uint32 target)
+{
+    int ok;
+    pthread_mutex_lock(&p->lock);
+    while (p->value < target && !p->done)
+        pthread_cond_wait(&p->cond, &p->lock);
+    ok = p->value >= target;
+    pthread_mutex_unlock(&p->lock);
+    return ok;
+}
+#endif
+#endif // !STBI_NO_PNG
+
+#endif // !STBI_NO_THREADS
+
 ///////////////////////////////////////////////
 //
 //  stbi__context struct and start_xxx functions
@@ -768,8 +1239,37 @@ typedef struct
 
     stbi_uc *img_buffer, *img_buffer_end;
     stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+    int num_threads; // decoders may split work across this many threads
+
+    // per-call settings, from stbi_load_options or the stbi_set_* globals
+    int flip;
+    int unpremultiply;
+    int jpeg_scale; // 1, 2, 4 or 8: JPEGs come out this many times smaller
+
+    // caller memory to decode into (stbi_load_into); NULL for a new buffer
+    stbi_uc *target;
+    size_t target_size;
+    int target_stride;
+
+    // set by stbi__alloc_rows: row 0 of the output, and the block it lives in
+    // (NULL when that's the caller's target)
+    stbi_uc *rows, *rows_base;
 } stbi__context;
 
+static int stbi__vertically_flip_on_load = 0;
+static int stbi__unpremultiply_on_load = 0;
+
+static void stbi__start_common(stbi__context *s)
+{
+    s->num_threads = 1;
+    s->flip = stbi__vertically_flip_on_load;
+    s->unpremultiply = stbi__unpremultiply_on_load;
+    s->jpeg_scale = 1;
+    s->target = NULL;
+    s->rows = s->rows_base = NULL;
+}
+
 
 static void stbi__refill_buffer(stbi__context *s);
 
@@ -780,6 +1280,7 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
     s->read_from_callbacks = 0;
     s->img_buffer = s->img_buffer_original = (stbi_uc *)buffer;
     s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *)buffer + len;
+    stbi__start_common(s);
 }
 
 // initialize a callback-based context
@@ -789,6 +1290,7 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
     s->io_user_data = user;
     s->buflen = sizeof(s->buffer_start);
     s->read_from_callbacks = 1;
+    stbi__start_common(s);
     s->img_buffer_original = s->buffer_start;
     stbi__refill_buffer(s);
     s->img_buffer_original_end = s->img_buffer_end;
@@ -903,9 +1405,6 @@ static void    *stbi__pnm_load(stbi__context *s, int *x, int *y, int *comp, int
 static int      stbi__pnm_info(stbi__context *s, int *x, int *y, int *comp);
 #endif
 
-// this is not threadsafe
-static const char *stbi__g_failure_reason;
-
 STBIDEF const char *stbi_failure_reason(void)
 {
     return stbi__g_failure_reason;
@@ -917,11 +1416,110 @@ static int stbi__err(const char *str)
     return 0;
 }
 
+///////////////////////////////////////////////
+//
+//  allocation: every internal buffer goes through stbi__malloc/stbi__free/
+//  stbi__realloc_sized, which use the calling thread's arena if it has one
+
+#define STBI__ARENA_ALIGN  16            // block alignment, and the size of each block's header
+#define STBI__ARENA_NONE   ((size_t)-1)
+
+static STBI_THREAD_LOCAL stbi_arena *stbi__g_arena;
+
+STBIDEF void stbi_arena_init(stbi_arena *arena, void *memory, size_t size)
+{
+    size_t pad = (STBI__ARENA_ALIGN - ((size_t)memory & (STBI__ARENA_ALIGN - 1))) & (STBI__ARENA_ALIGN - 1);
+    if (pad > size) pad = size;
+    arena->base = (stbi_uc *)memory + pad;
+    arena->size = size - pad;
+    stbi_arena_reset(arena);
+}
+
+STBIDEF void stbi_arena_reset(stbi_arena *arena)
+{
+    arena->used = 0;
+    arena->last = STBI__ARENA_NONE;
+    arena->peak = 0;
+    arena->total = 0;
+    arena->count = 0;
+}
+
+STBIDEF stbi_arena *stbi_set_thread_arena(stbi_arena *arena)
+{
+    stbi_arena *prev = stbi__g_arena;
+    stbi__g_arena = arena;
+    return prev;
+}
+
+static int stbi__arena_owns(stbi_arena *a, void *p)
+{
+    return a && (stbi_uc *)p >= a->base && (stbi_uc *)p < a->base + a->size;
+}
+
+static int stbi__arena_is_last(stbi_arena *a, void *p)
+{
+    return a->last != STBI__ARENA_NONE && (stbi_uc *)p == a->base + a->last + STBI__ARENA_ALIGN;
+}
+
+static void *stbi__arena_alloc(stbi_arena *a, size_t size)
+{
+    size_t start = (a->used + STBI__ARENA_ALIGN - 1) & ~(size_t)(STBI__ARENA_ALIGN - 1);
+    if (start > a->size || a->size - start < STBI__ARENA_ALIGN || a->size - start - STBI__ARENA_ALIGN < size)
+        return NULL;
+    *(size_t *)(a->base + start) = size;
+    a->last = start;
+    a->used = start + STBI__ARENA_ALIGN + size;
+    if (a->used > a->peak) a->peak = a->used;
+    a->total += size;
+    ++a->count;
+    return a->base + start + STBI__ARENA_ALIGN;
+}
+
 static void *stbi__malloc(size_t size)
 {
+    if (stbi__g_arena) return stbi__arena_alloc(stbi__g_arena, size);
     return STBI_MALLOC(size);
 }
 
+static void stbi__free(void *p)
+{
+    stbi_arena *a = stbi__g_arena;
+    if (stbi__arena_owns(a, p)) {
+        // only the newest block can be handed back; the rest waits for stbi_arena_reset
+        if (stbi__arena_is_last(a, p)) {
+            a->used = a->last;
+            a->last = STBI__ARENA_NONE;
+        }
+        return;
+    }
+    STBI_FREE(p);
+}
+
+// only zlib output and PNG image data grow
+#ifndef STBI_NO_ZLIB
+static void *stbi__realloc_sized(void *p, size_t oldsz, size_t newsz)
+{
+    stbi_arena *a = stbi__g_arena;
+    if (stbi__arena_owns(a, p)) {
+        size_t *header = (size_t *)((stbi_uc *)p - STBI__ARENA_ALIGN);
+        void *q;
+        if (stbi__arena_is_last(a, p) && newsz <= a->size - a->last - STBI__ARENA_ALIGN) {
+            // newest block: grow or shrink it in place
+            if (newsz > *header) a->total += newsz - *header;
+            *header = newsz;
+            a->used = a->last + STBI__ARENA_ALIGN + newsz;
+            if (a->used > a->peak) a->peak = a->used;
+            return p;
+        }
+        q = stbi__arena_alloc(a, newsz);
+        if (q) memcpy(q, p, *header < newsz ? *header : newsz);
+        return q;
+    }
+    STBI_NOTUSED(oldsz);
+    return STBI_REALLOC_SIZED(p, oldsz, newsz);
+}
+#endif
+
 // stb_image uses ints pervasively, including for offset calculations.
 // therefore the largest decoded image size we can support with the
 // current code, even on 64-bit targets, is INT_MAX. this is not a
@@ -1010,7 +1608,7 @@ static void *stbi__malloc_mad4(int a, int b, int c, int d, int add)
 
 STBIDEF void stbi_image_free(void *retval_from_stbi_load)
 {
-    STBI_FREE(retval_from_stbi_load);
+    stbi__free(retval_from_stbi_load);
 }
 
 #ifndef STBI_NO_LINEAR
@@ -1021,13 +1619,88 @@ static float   *stbi__ldr_to_hdr(stbi_uc *data, int x, int y, int comp);
 static stbi_uc *stbi__hdr_to_ldr(float   *data, int x, int y, int comp);
 #endif
 
-static int stbi__vertically_flip_on_load = 0;
-
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip)
 {
     stbi__vertically_flip_on_load = flag_true_if_should_flip;
 }
 
+// where an n-channel w*h result gets written: the caller's target, or a
+// new buffer. rows are *stride bytes apart starting from the returned
+// row 0, and the stride is negative when flipping, so decoders that write
+// their output a row at a time through this get the flip for free.
+static stbi_uc *stbi__alloc_rows(stbi__context *s, int w, int h, int n, int *stride)
+{
+    size_t row_bytes = (size_t)w * n;
+    stbi_uc *base;
+    if (s->target) {
+        if (s->target_stride < 0 || (size_t)s->target_stride < row_bytes)
+            return stbi__errpuc("bad stride", "Target row stride is smaller than a row");
+        if (row_bytes > s->target_size || (size_t)(h - 1) > (s->target_size - row_bytes) / (size_t)s->target_stride)
+            return stbi__errpuc("target too small", "Image doesn't fit in the target buffer");
+        base = s->target;
+        *stride = s->target_stride;
+        s->rows_base = NULL;
+    }
+    else {
+        base = (stbi_uc *)stbi__malloc_mad3(n, w, h, 0);
+        if (!base) return stbi__errpuc("outofmem", "Out of memory");
+        *stride = (int)row_bytes;
+        s->rows_base = base;
+    }
+    s->rows = s->flip ? base + (size_t)(h - 1) * *stride : base;
+    if (s->flip) *stride = -*stride;
+    return s->rows;
+}
+
+// release the output of stbi__alloc_rows after a failed decode; PNG and
+// the threaded JPEG conversion write rows before they know they'll succeed
+#if !defined(STBI_NO_PNG) || (!defined(STBI_NO_JPEG) && !defined(STBI_NO_THREADS))
+static void stbi__free_rows(stbi__context *s)
+{
+    stbi__free(s->rows_base);
+    s->rows = s->rows_base = NULL;
+}
+#endif
+
+static void stbi__vertical_flip(void *image, int w, int h, int bytes_per_pixel)
+{
+    int row;
+    size_t bytes_per_row = (size_t)w * bytes_per_pixel;
+    stbi_uc temp[2048];
+    stbi_uc *bytes = (stbi_uc *)image;
+
+    for (row = 0; row < (h >> 1); row++) {
+        stbi_uc *row0 = bytes + row * bytes_per_row;
+        stbi_uc *row1 = bytes + (h - row - 1) * bytes_per_row;
+        // swap row0 with row1
+        size_t bytes_left = bytes_per_row;
+        while (bytes_left) {
+            size_t bytes_copy = (bytes_left < sizeof(temp)) ? bytes_left : sizeof(temp);
+            memcpy(temp, row0, bytes_copy);
+            memcpy(row0, row1, bytes_copy);
+            memcpy(row1, temp, bytes_copy);
+            row0 += bytes_copy;
+            row1 += bytes_copy;
+            bytes_left -= bytes_copy;
+        }
+    }
+}
+
+// copy a finished n-channel w*h image into the caller's target, flipping it
+// on the way. the size comes from the loader's result, since not every
+// loader fills in s->img_x and s->img_y
+static stbi_uc *stbi__copy_to_target(stbi__context *s, stbi_uc *image, int w, int h, int n)
+{
+    int stride, j;
+    stbi_uc *out = stbi__alloc_rows(s, w, h, n, &stride);
+    if (out) {
+        for (j = 0; j < h; ++j)
+            memcpy(out + (ptrdiff_t)stride * j, image + (size_t)w * n * j, (size_t)w * n);
+    }
+    stbi__free(image);
+    return out ? s->target : NULL;
+}
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
     memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1085,7 +1758,7 @@ static stbi_uc *stbi__convert_16_to_8(stbi__uint16 *orig, int w, int h, int chan
     for (i = 0; i < img_len; ++i)
         reduced[i] = (stbi_uc)((orig[i] >> 8) & 0xFF); // top half of each byte is sufficient approx of 16->8 bit scaling
 
-    STBI_FREE(orig);
+    stbi__free(orig);
     return reduced;
 }
 
@@ -1101,7 +1774,7 @@ static stbi__uint16 *stbi__convert_8_to_16(stbi_uc *orig, int w, int h, int chan
     for (i = 0; i < img_len; ++i)
         enlarged[i] = (stbi__uint16)((orig[i] << 8) + orig[i]); // replicate to high and low byte, maps 0->0, 255->0xffff
 
-    STBI_FREE(orig);
+    stbi__free(orig);
     return enlarged;
 }
 
@@ -1113,6 +1786,10 @@ static unsigned char *stbi__load_and_postprocess_8bit(stbi__context *s, int *x,
     if (result == NULL)
         return NULL;
 
+    // written a row at a time through stbi__alloc_rows, already flipped
+    if (result == s->rows)
+        return s->target ? s->target : s->rows_base;
+
     if (ri.bits_per_channel != 8) {
         STBI_ASSERT(ri.bits_per_channel == 16);
         result = stbi__convert_16_to_8((stbi__uint16 *)result, *x, *y, req_comp == 0 ? *comp : req_comp);
@@ -1121,23 +1798,11 @@ static unsigned char *stbi__load_and_postprocess_8bit(stbi__context *s, int *x,
 
     // @TODO: move stbi__convert_format to here
 
-    if (stbi__vertically_flip_on_load) {
-        int w = *x, h = *y;
-        int channels = req_comp ? req_comp : *comp;
-        int row, col, z;
-        stbi_uc *image = (stbi_uc *)result;
-
-        // @OPTIMIZE: use a bigger temp buffer and memcpy multiple pixels at once
-        for (row = 0; row < (h >> 1); row++) {
-            for (col = 0; col < w; col++) {
-                for (z = 0; z < channels; z++) {
-                    stbi_uc temp = image[(row * w + col) * channels + z];
-                    image[(row * w + col) * channels + z] = image[((h - row - 1) * w + col) * channels + z];
-                    image[((h - row - 1) * w + col) * channels + z] = temp;
-                }
-            }
-        }
-    }
+    if (s->target)
+        return stbi__copy_to_target(s, (stbi_uc *)result, *x, *y, req_comp ? req_comp : *comp);
+
+    if (s->flip)
+        stbi__vertical_flip(result, *x, *y, req_comp ? req_comp : *comp);
 
     return (unsigned char *)result;
 }
@@ -1146,10 +1811,16 @@ static stbi__uint16 *stbi__load_and_postprocess_16bit(stbi__context *s, int *x,
 {
     stbi__result_info ri;
     void *result = stbi__load_main(s, x, y, comp, req_comp, &ri, 16);
+    int flipped = 0;
 
     if (result == NULL)
         return NULL;
 
+    if (result == s->rows) {
+        result = s->rows_base;
+        flipped = 1;
+    }
+
     if (ri.bits_per_channel != 16) {
         STBI_ASSERT(ri.bits_per_channel == 8);
         result = stbi__convert_8_to_16((stbi_uc *)result, *x, *y, req_comp == 0 ? *comp : req_comp);
@@ -1159,47 +1830,17 @@ static stbi__uint16 *stbi__load_and_postprocess_16bit(stbi__context *s, int *x,
     // @TODO: move stbi__convert_format16 to here
     // @TODO: special case RGB-to-Y (and RGBA-to-YA) for 8-bit-to-16-bit case to keep more precision
 
-    if (stbi__vertically_flip_on_load) {
-        int w = *x, h = *y;
-        int channels = req_comp ? req_comp : *comp;
-        int row, col, z;
-        stbi__uint16 *image = (stbi__uint16 *)result;
-
-        // @OPTIMIZE: use a bigger temp buffer and memcpy multiple pixels at once
-        for (row = 0; row < (h >> 1); row++) {
-            for (col = 0; col < w; col++) {
-                for (z = 0; z < channels; z++) {
-                    stbi__uint16 temp = image[(row * w + col) * channels + z];
-                    image[(row * w + col) * channels + z] = image[((h - row - 1) * w + col) * channels + z];
-                    image[((h - row - 1) * w + col) * channels + z] = temp;
-                }
-            }
-        }
-    }
+    if (s->flip && !flipped)
+        stbi__vertical_flip(result, *x, *y, (req_comp ? req_comp : *comp) * 2);
 
     return (stbi__uint16 *)result;
 }
 
 #ifndef STBI_NO_HDR
-static void stbi__float_postprocess(float *result, int *x, int *y, int *comp, int req_comp)
-{
-    if (stbi__vertically_flip_on_load && result != NULL) {
-        int w = *x, h = *y;
-        int depth = req_comp ? req_comp : *comp;
-        int row, col, z;
-        float temp;
-
-        // @OPTIMIZE: use a bigger temp buffer and memcpy multiple pixels at once
-        for (row = 0; row < (h >> 1); row++) {
-            for (col = 0; col < w; col++) {
-                for (z = 0; z < depth; z++) {
-                    temp = result[(row * w + col) * depth + z];
-                    result[(row * w + col) * depth + z] = result[((h - row - 1) * w + col) * depth + z];
-                    result[((h - row - 1) * w + col) * depth + z] = temp;
-                }
-            }
-        }
-    }
+static void stbi__float_postprocess(stbi__context *s, float *result, int *x, int *y, int *comp, int req_comp)
+{
+    if (s->flip && result != NULL)
+        stbi__vertical_flip(result, *x, *y, (req_comp ? req_comp : *comp) * sizeof(float));
 }
 #endif
 
@@ -1281,6 +1922,237 @@ STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *u
     return stbi__load_and_postprocess_8bit(&s, x, y, comp, req_comp);
 }
 
+STBIDEF stbi_uc *stbi_load_from_memory_parallel(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, int num_threads)
+{
+    stbi__context s;
+    stbi__start_mem(&s, buffer, len);
+#ifndef STBI_NO_THREADS
+    s.num_threads = stbi__clamp_threads(num_threads);
+#else
+    STBI_NOTUSED(num_threads);
+#endif
+    return stbi__load_and_postprocess_8bit(&s, x, y, comp, req_comp);
+}
+
+static int stbi__apply_options(stbi__context *s, stbi_load_options const *options)
+{
+    int scale = options->jpeg_scale ? options->jpeg_scale : 1;
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+        return stbi__err("bad jpeg_scale", "jpeg_scale must be 1, 2, 4 or 8");
+    s->flip = options->flip_vertically;
+    s->unpremultiply = options->unpremultiply;
+    s->jpeg_scale = scale;
+    return 1;
+}
+
+static stbi_uc *stbi__load_ex(stbi__context *s, int *x, int *y, int *comp, stbi_load_options const *options)
+{
+    static const stbi_load_options defaults = { 0, 0, 0, NULL, 0 };
+    stbi_arena *prev = NULL;
+    stbi_uc *result;
+    if (!options) options = &defaults;
+    if (!stbi__apply_options(s, options)) return NULL;
+    if (options->arena) prev = stbi_set_thread_arena(options->arena);
+    result = stbi__load_and_postprocess_8bit(s, x, y, comp, options->desired_channels);
+    if (options->arena) stbi_set_thread_arena(prev);
+    return result;
+}
+
+STBIDEF stbi_uc *stbi_load_from_memory_ex(stbi_uc const *buffer, int len, int *x, int *y, int *comp, stbi_load_options const *options)
+{
+    stbi__context s;
+    stbi__start_mem(&s, buffer, len);
+    return stbi__load_ex(&s, x, y, comp, options);
+}
+
+STBIDEF stbi_uc *stbi_load_from_callbacks_ex(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp, stbi_load_options const *options)
+{
+    stbi__context s;
+    stbi__start_callbacks(&s, (stbi_io_callbacks *)clbk, user);
+    return stbi__load_ex(&s, x, y, comp, options);
+}
+
+static int stbi__load_into(stbi__context *s, stbi_uc *dst, size_t dst_size, int stride, int *x, int *y, int *comp, int req_comp, int flip)
+{
+    s->target = dst;
+    s->target_size = dst_size;
+    s->target_stride = stride;
+    s->flip = flip;
+    return stbi__load_and_postprocess_8bit(s, x, y, comp, req_comp) != NULL;
+}
+
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *dst, size_t dst_size, int stride, int *x, int *y, int *comp, int req_comp, int flip)
+{
+    stbi__context s;
+    stbi__start_mem(&s, buffer, len);
+    return stbi__load_into(&s, dst, dst_size, stride, x, y, comp, req_comp, flip);
+}
+
+#ifndef STBI_NO_STDIO
+
+// read-only view of a whole file. memory-mapped where the platform allows it
+// (define STBI_NO_MMAP to always read the file into a heap buffer instead)
+#if !defined(STBI_NO_MMAP) && defined(_WIN32)
+#define STBI__MMAP_WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif !defined(STBI_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define STBI__MMAP_POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+typedef struct
+{
+    stbi_uc *data;
+    int len;
+    int mapped; // 0: data came from stbi__malloc
+#ifdef STBI__MMAP_WIN32
+    HANDLE mapping;
+#endif
+} stbi__file_view;
+
+static int stbi__map_file(stbi__file_view *v, char const *filename)
+{
+#if defined(STBI__MMAP_WIN32)
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 && size.QuadPart <= INT_MAX) {
+        v->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (v->mapping) {
+            v->data = (stbi_uc *)MapViewOfFile(v->mapping, FILE_MAP_READ, 0, 0, 0);
+            if (v->data) {
+                CloseHandle(file); // the mapping keeps the file open
+                v->len = (int)size.QuadPart;
+                v->mapped = 1;
+                return 1;
+            }
+            CloseHandle(v->mapping);
+        }
+    }
+    CloseHandle(file);
+    return 0;
+#elif defined(STBI__MMAP_POSIX)
+    struct stat st;
+    void *p;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > INT_MAX) {
+        close(fd);
+        return 0;
+    }
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (p == MAP_FAILED) return 0;
+#ifdef MADV_SEQUENTIAL
+    // decoders read front to back: ask for aggressive readahead and start it now
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+    madvise(p, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+    v->data = (stbi_uc *)p;
+    v->len = (int)st.st_size;
+    v->mapped = 1;
+    return 1;
+#else
+    STBI_NOTUSED(v);
+    STBI_NOTUSED(filename);
+    return 0;
+#endif
+}
+
+static int stbi__open_file_view(stbi__file_view *v, char const *filename)
+{
+    FILE *f;
+    long len;
+    v->data = NULL;
+    v->len = 0;
+    v->mapped = 0;
+    if (stbi__map_file(v, filename)) return 1;
+
+    // no mapping (empty file, pipe, unsupported platform): read it all up front
+    f = stbi__fopen(filename, "rb");
+    if (!f) return stbi__err("can't fopen", "Unable to open file");
+    if (fseek(f, 0, SEEK_END) != 0 || (len = ftell(f)) < 0 || len > INT_MAX || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return stbi__err("can't fopen", "Unable to read file");
+    }
+    v->data = (stbi_uc *)stbi__malloc(len ? len : 1);
+    if (!v->data) { fclose(f); return stbi__err("outofmem", "Out of memory"); }
+    if (fread(v->data, 1, len, f) != (size_t)len) {
+        fclose(f);
+        stbi__free(v->data);
+        return stbi__err("can't fopen", "Unable to read file");
+    }
+    fclose(f);
+    v->len = (int)len;
+    return 1;
+}
+
+static void stbi__close_file_view(stbi__file_view *v)
+{
+    if (!v->mapped) {
+        stbi__free(v->data);
+        return;
+    }
+#if defined(STBI__MMAP_WIN32)
+    UnmapViewOfFile(v->data);
+    CloseHandle(v->mapping);
+#elif defined(STBI__MMAP_POSIX)
+    munmap(v->data, (size_t)v->len);
+#endif
+}
+
+STBIDEF stbi_uc *stbi_load_mapped(char const *filename, int *x, int *y, int *comp, int req_comp)
+{
+    stbi__file_view v;
+    stbi_uc *result;
+    if (!stbi__open_file_view(&v, filename)) return NULL;
+    result = stbi_load_from_memory(v.data, v.len, x, y, comp, req_comp);
+    stbi__close_file_view(&v);
+    return result;
+}
+
+STBIDEF stbi_uc *stbi_load_ex(char const *filename, int *x, int *y, int *comp, stbi_load_options const *options)
+{
+    stbi__file_view v;
+    stbi__context s;
+    stbi_uc *result;
+    if (!stbi__open_file_view(&v, filename)) return NULL;
+    stbi__start_mem(&s, v.data, v.len);
+    result = stbi__load_ex(&s, x, y, comp, options);
+    stbi__close_file_view(&v);
+    return result;
+}
+
+STBIDEF int stbi_load_into(char const *filename, stbi_uc *dst, size_t dst_size, int stride, int *x, int *y, int *comp, int req_comp, int flip)
+{
+    stbi__file_view v;
+    stbi__context s;
+    int result;
+    if (!stbi__open_file_view(&v, filename)) return 0;
+    stbi__start_mem(&s, v.data, v.len);
+    result = stbi__load_into(&s, dst, dst_size, stride, x, y, comp, req_comp, flip);
+    stbi__close_file_view(&v);
+    return result;
+}
+
+STBIDEF stbi_uc *stbi_load_parallel(char const *filename, int *x, int *y, int *comp, int req_comp, int num_threads)
+{
+    // the parallel JPEG path slices the scan in memory, so it needs the whole file up front
+    stbi__file_view v;
+    stbi_uc *result;
+    if (!stbi__open_file_view(&v, filename)) return NULL;
+    result = stbi_load_from_memory_parallel(v.data, v.len, x, y, comp, req_comp, num_threads);
+    stbi__close_file_view(&v);
+    return result;
+}
+#endif
+
 #ifndef STBI_NO_LINEAR
 static float *stbi__loadf_main(stbi__context *s, int *x, int *y, int *comp, int req_comp)
 {
@@ -1290,7 +2162,7 @@ static float *stbi__loadf_main(stbi__context *s, int *x, int *y, int *comp, int
         stbi__result_info ri;
         float *hdr_data = stbi__hdr_load(s, x, y, comp, req_comp, &ri);
         if (hdr_data)
-            stbi__float_postprocess(hdr_data, x, y, comp, req_comp);
+            stbi__float_postprocess(s, hdr_data, x, y, comp, req_comp);
         return hdr_data;
     }
 #endif
@@ -1556,7 +2428,7 @@ static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int r
 
     good = (unsigned char *)stbi__malloc_mad3(req_comp, x, y, 0);
     if (good == NULL) {
-        STBI_FREE(data);
+        stbi__free(data);
         return stbi__errpuc("outofmem", "Out of memory");
     }
 
@@ -1586,7 +2458,7 @@ static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int r
 #undef STBI__CASE
     }
 
-    STBI_FREE(data);
+    stbi__free(data);
     return good;
 }
 
@@ -1605,7 +2477,7 @@ static stbi__uint16 *stbi__convert_format16(stbi__uint16 *data, int img_n, int r
 
     good = (stbi__uint16 *)stbi__malloc(req_comp * x * y * 2);
     if (good == NULL) {
-        STBI_FREE(data);
+        stbi__free(data);
         return (stbi__uint16 *)stbi__errpuc("outofmem", "Out of memory");
     }
 
@@ -1635,7 +2507,7 @@ static stbi__uint16 *stbi__convert_format16(stbi__uint16 *data, int img_n, int r
 #undef STBI__CASE
     }
 
-    STBI_FREE(data);
+    stbi__free(data);
     return good;
 }
 
@@ -1646,7 +2518,7 @@ static float   *stbi__ldr_to_hdr(stbi_uc *data, int x, int y, int comp)
     float *output;
     if (!data) return NULL;
     output = (float *)stbi__malloc_mad4(x, y, comp, sizeof(float), 0);
-    if (output == NULL) { STBI_FREE(data); return stbi__errpf("outofmem", "Out of memory"); }
+    if (output == NULL) { stbi__free(data); return stbi__errpf("outofmem", "Out of memory"); }
     // compute number of non-alpha components
     if (comp & 1) n = comp; else n = comp - 1;
     for (i = 0; i < x*y; ++i) {
@@ -1655,7 +2527,7 @@ static float   *stbi__ldr_to_hdr(stbi_uc *data, int x, int y, int comp)
         }
         if (k < comp) output[i*comp + k] = data[i*comp + k] / 255.0f;
     }
-    STBI_FREE(data);
+    stbi__free(data);
     return output;
 }
 #endif
@@ -1668,7 +2540,7 @@ static stbi_uc *stbi__hdr_to_ldr(float   *data, int x, int y, int comp)
     stbi_uc *output;
     if (!data) return NULL;
     output = (stbi_uc *)stbi__malloc_mad3(x, y, comp, 0);
-    if (output == NULL) { STBI_FREE(data); return stbi__errpuc("outofmem", "Out of memory"); }
+    if (output == NULL) { stbi__free(data); return stbi__errpuc("outofmem", "Out of memory"); }
     // compute number of non-alpha components
     if (comp & 1) n = comp; else n = comp - 1;
     for (i = 0; i < x*y; ++i) {
@@ -1685,7 +2557,7 @@ static stbi_uc *stbi__hdr_to_ldr(float   *data, int x, int y, int comp)
             output[i*comp + k] = (stbi_uc)stbi__float2int(z);
         }
     }
-    STBI_FREE(data);
+    stbi__free(data);
     return output;
 }
 #endif
@@ -1773,6 +2645,8 @@ typedef struct
     int scan_n, order[4];
     int restart_interval, todo;
 
+    int block_size; // side of each block's pixels in the planes: 8, or 4/2/1 when scaling
+
     // kernels
     void(*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
     void(*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
@@ -2297,53 +3171,230 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
     }
 }
 
-#ifdef STBI_SSE2
-// sse2 integer IDCT. not the fastest possible implementation but it
-// produces bit-identical results to the generic C version so it's
-// fully "transparent".
-static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
+#ifdef STBI_SSE2
+// sse2 integer IDCT. not the fastest possible implementation but it
+// produces bit-identical results to the generic C version so it's
+// fully "transparent".
+static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
+{
+    // This is constructed to match our regular (generic) integer IDCT exactly.
+    __m128i row0, row1, row2, row3, row4, row5, row6, row7;
+    __m128i tmp;
+
+    // dot product constant: even elems=x, odd elems=y
+#define dct_const(x,y)  _mm_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y))
+
+    // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
+    // out(1) = c1[even]*x + c1[odd]*y
+#define dct_rot(out0,out1, x,y,c0,c1) \
+      __m128i c0##lo = _mm_unpacklo_epi16((x),(y)); \
+      __m128i c0##hi = _mm_unpackhi_epi16((x),(y)); \
+      __m128i out0##_l = _mm_madd_epi16(c0##lo, c0); \
+      __m128i out0##_h = _mm_madd_epi16(c0##hi, c0); \
+      __m128i out1##_l = _mm_madd_epi16(c0##lo, c1); \
+      __m128i out1##_h = _mm_madd_epi16(c0##hi, c1)
+
+    // out = in << 12  (in 16-bit, out 32-bit)
+#define dct_widen(out, in) \
+      __m128i out##_l = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), (in)), 4); \
+      __m128i out##_h = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), (in)), 4)
+
+    // wide add
+#define dct_wadd(out, a, b) \
+      __m128i out##_l = _mm_add_epi32(a##_l, b##_l); \
+      __m128i out##_h = _mm_add_epi32(a##_h, b##_h)
+
+    // wide sub
+#define dct_wsub(out, a, b) \
+      __m128i out##_l = _mm_sub_epi32(a##_l, b##_l); \
+      __m128i out##_h = _mm_sub_epi32(a##_h, b##_h)
+
+    // butterfly a/b, add bias, then shift by "s" and pack
+#define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m128i abiased_l = _mm_add_epi32(a##_l, bias); \
+         __m128i abiased_h = _mm_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm_packs_epi32(_mm_srai_epi32(sum_l, s), _mm_srai_epi32(sum_h, s)); \
+         out1 = _mm_packs_epi32(_mm_srai_epi32(dif_l, s), _mm_srai_epi32(dif_h, s)); \
+      }
+
+    // 8-bit interleave step (for transposes)
+#define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi8(a, b); \
+      b = _mm_unpackhi_epi8(tmp, b)
+
+    // 16-bit interleave step (for transposes)
+#define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi16(a, b); \
+      b = _mm_unpackhi_epi16(tmp, b)
+
+#define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m128i sum04 = _mm_add_epi16(row0, row4); \
+         __m128i dif04 = _mm_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m128i sum17 = _mm_add_epi16(row1, row7); \
+         __m128i sum35 = _mm_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+    __m128i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+    __m128i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f(0.765366865f), stbi__f2f(0.5411961f));
+    __m128i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+    __m128i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+    __m128i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f(0.298631336f), stbi__f2f(-1.961570560f));
+    __m128i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f(3.072711026f));
+    __m128i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f(2.053119869f), stbi__f2f(-0.390180644f));
+    __m128i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f(1.501321110f));
+
+    // rounding biases in column/row passes, see stbi__idct_block for explanation.
+    __m128i bias_0 = _mm_set1_epi32(512);
+    __m128i bias_1 = _mm_set1_epi32(65536 + (128 << 17));
+
+    // load
+    row0 = _mm_load_si128((const __m128i *) (data + 0 * 8));
+    row1 = _mm_load_si128((const __m128i *) (data + 1 * 8));
+    row2 = _mm_load_si128((const __m128i *) (data + 2 * 8));
+    row3 = _mm_load_si128((const __m128i *) (data + 3 * 8));
+    row4 = _mm_load_si128((const __m128i *) (data + 4 * 8));
+    row5 = _mm_load_si128((const __m128i *) (data + 5 * 8));
+    row6 = _mm_load_si128((const __m128i *) (data + 6 * 8));
+    row7 = _mm_load_si128((const __m128i *) (data + 7 * 8));
+
+    // column pass
+    dct_pass(bias_0, 10);
+
+    {
+        // 16bit 8x8 transpose pass 1
+        dct_interleave16(row0, row4);
+        dct_interleave16(row1, row5);
+        dct_interleave16(row2, row6);
+        dct_interleave16(row3, row7);
+
+        // transpose pass 2
+        dct_interleave16(row0, row2);
+        dct_interleave16(row1, row3);
+        dct_interleave16(row4, row6);
+        dct_interleave16(row5, row7);
+
+        // transpose pass 3
+        dct_interleave16(row0, row1);
+        dct_interleave16(row2, row3);
+        dct_interleave16(row4, row5);
+        dct_interleave16(row6, row7);
+    }
+
+    // row pass
+    dct_pass(bias_1, 17);
+
+    {
+        // pack
+        __m128i p0 = _mm_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+        __m128i p1 = _mm_packus_epi16(row2, row3);
+        __m128i p2 = _mm_packus_epi16(row4, row5);
+        __m128i p3 = _mm_packus_epi16(row6, row7);
+
+        // 8bit 8x8 transpose pass 1
+        dct_interleave8(p0, p2); // a0e0a1e1...
+        dct_interleave8(p1, p3); // c0g0c1g1...
+
+                                 // transpose pass 2
+        dct_interleave8(p0, p1); // a0c0e0g0...
+        dct_interleave8(p2, p3); // b0d0f0h0...
+
+                                 // transpose pass 3
+        dct_interleave8(p0, p2); // a0b0c0d0...
+        dct_interleave8(p1, p3); // a4b4c4d4...
+
+                                 // store
+        _mm_storel_epi64((__m128i *) out, p0); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p0, 0x4e)); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, p2); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p2, 0x4e)); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, p1); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p1, 0x4e)); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, p3); out += out_stride;
+        _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p3, 0x4e));
+    }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+}
+
+#endif // STBI_SSE2
+
+#ifdef STBI_AVX2
+// avx2 integer IDCT. same structure as stbi__idct_simd; the 16-bit rows and
+// the transposes stay in 128-bit registers, but all of the 32-bit
+// intermediate math is done on a full row at once.
+STBI__AVX2_TARGET
+static void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[64])
 {
-    // This is constructed to match our regular (generic) integer IDCT exactly.
     __m128i row0, row1, row2, row3, row4, row5, row6, row7;
     __m128i tmp;
 
     // dot product constant: even elems=x, odd elems=y
-#define dct_const(x,y)  _mm_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y))
+#define dct_const(x,y)  _mm256_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y))
 
     // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
     // out(1) = c1[even]*x + c1[odd]*y
 #define dct_rot(out0,out1, x,y,c0,c1) \
-      __m128i c0##lo = _mm_unpacklo_epi16((x),(y)); \
-      __m128i c0##hi = _mm_unpackhi_epi16((x),(y)); \
-      __m128i out0##_l = _mm_madd_epi16(c0##lo, c0); \
-      __m128i out0##_h = _mm_madd_epi16(c0##hi, c0); \
-      __m128i out1##_l = _mm_madd_epi16(c0##lo, c1); \
-      __m128i out1##_h = _mm_madd_epi16(c0##hi, c1)
+      __m256i c0##xy = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16((x),(y))), _mm_unpackhi_epi16((x),(y)), 1); \
+      __m256i out0 = _mm256_madd_epi16(c0##xy, c0); \
+      __m256i out1 = _mm256_madd_epi16(c0##xy, c1)
 
     // out = in << 12  (in 16-bit, out 32-bit)
 #define dct_widen(out, in) \
-      __m128i out##_l = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_setzero_si128(), (in)), 4); \
-      __m128i out##_h = _mm_srai_epi32(_mm_unpackhi_epi16(_mm_setzero_si128(), (in)), 4)
+      __m256i out = _mm256_slli_epi32(_mm256_cvtepi16_epi32(in), 12)
 
     // wide add
 #define dct_wadd(out, a, b) \
-      __m128i out##_l = _mm_add_epi32(a##_l, b##_l); \
-      __m128i out##_h = _mm_add_epi32(a##_h, b##_h)
+      __m256i out = _mm256_add_epi32(a, b)
 
     // wide sub
 #define dct_wsub(out, a, b) \
-      __m128i out##_l = _mm_sub_epi32(a##_l, b##_l); \
-      __m128i out##_h = _mm_sub_epi32(a##_h, b##_h)
+      __m256i out = _mm256_sub_epi32(a, b)
 
     // butterfly a/b, add bias, then shift by "s" and pack
+    // (packs works per 128-bit lane, the permute puts the halves back in order)
 #define dct_bfly32o(out0, out1, a,b,bias,s) \
       { \
-         __m128i abiased_l = _mm_add_epi32(a##_l, bias); \
-         __m128i abiased_h = _mm_add_epi32(a##_h, bias); \
+         __m256i abiased = _mm256_add_epi32(a, bias); \
          dct_wadd(sum, abiased, b); \
          dct_wsub(dif, abiased, b); \
-         out0 = _mm_packs_epi32(_mm_srai_epi32(sum_l, s), _mm_srai_epi32(sum_h, s)); \
-         out1 = _mm_packs_epi32(_mm_srai_epi32(dif_l, s), _mm_srai_epi32(dif_h, s)); \
+         __m256i packed = _mm256_packs_epi32(_mm256_srai_epi32(sum, s), _mm256_srai_epi32(dif, s)); \
+         packed = _mm256_permute4x64_epi64(packed, 0xd8); \
+         out0 = _mm256_castsi256_si128(packed); \
+         out1 = _mm256_extracti128_si256(packed, 1); \
       }
 
     // 8-bit interleave step (for transposes)
@@ -2386,18 +3437,18 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
          dct_bfly32o(row3,row4, x3,x4,bias,shift); \
       }
 
-    __m128i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
-    __m128i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f(0.765366865f), stbi__f2f(0.5411961f));
-    __m128i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
-    __m128i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
-    __m128i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f(0.298631336f), stbi__f2f(-1.961570560f));
-    __m128i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f(3.072711026f));
-    __m128i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f(2.053119869f), stbi__f2f(-0.390180644f));
-    __m128i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f(1.501321110f));
+    __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+    __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f(0.765366865f), stbi__f2f(0.5411961f));
+    __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+    __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+    __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f(0.298631336f), stbi__f2f(-1.961570560f));
+    __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f(3.072711026f));
+    __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f(2.053119869f), stbi__f2f(-0.390180644f));
+    __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f(1.501321110f));
 
     // rounding biases in column/row passes, see stbi__idct_block for explanation.
-    __m128i bias_0 = _mm_set1_epi32(512);
-    __m128i bias_1 = _mm_set1_epi32(65536 + (128 << 17));
+    __m256i bias_0 = _mm256_set1_epi32(512);
+    __m256i bias_1 = _mm256_set1_epi32(65536 + (128 << 17));
 
     // load
     row0 = _mm_load_si128((const __m128i *) (data + 0 * 8));
@@ -2446,15 +3497,15 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
         dct_interleave8(p0, p2); // a0e0a1e1...
         dct_interleave8(p1, p3); // c0g0c1g1...
 
-                                 // transpose pass 2
+        // transpose pass 2
         dct_interleave8(p0, p1); // a0c0e0g0...
         dct_interleave8(p2, p3); // b0d0f0h0...
 
-                                 // transpose pass 3
+        // transpose pass 3
         dct_interleave8(p0, p2); // a0b0c0d0...
         dct_interleave8(p1, p3); // a4b4c4d4...
 
-                                 // store
+        // store
         _mm_storel_epi64((__m128i *) out, p0); out += out_stride;
         _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p0, 0x4e)); out += out_stride;
         _mm_storel_epi64((__m128i *) out, p2); out += out_stride;
@@ -2476,7 +3527,7 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 #undef dct_pass
 }
 
-#endif // STBI_SSE2
+#endif // STBI_AVX2
 
 #ifdef STBI_NEON
 
@@ -2720,68 +3771,210 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
     // since we don't even allow 1<<30 pixels
 }
 
-static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+// IDCT one block into the component plane, which holds block_size x block_size
+// pixels per block when decoding at a reduced scale. a scaled block is the
+// average of each group of pixels the full IDCT produces: the SIMD kernel
+// and a few adds beat a dedicated 4x4 or 2x2 transform, and at 1/8 the DC
+// term alone is the average.
+stbi_inline static void stbi__jpeg_idct(stbi__jpeg *z, stbi_uc *out, int out_stride, short data[64])
 {
-    stbi__jpeg_reset(z);
-    if (!z->progressive) {
-        if (z->scan_n == 1) {
-            int i, j;
-            STBI_SIMD_ALIGN(short, data[64]);
-            int n = z->order[0];
-            // non-interleaved data, we just need to process one block at a time,
-            // in trivial scanline order
-            // number of blocks to do just depends on how many actual "pixels" this
-            // component has, independent of interleaved MCU blocking and such
-            int w = (z->img_comp[n].x + 7) >> 3;
-            int h = (z->img_comp[n].y + 7) >> 3;
-            for (j = 0; j < h; ++j) {
-                for (i = 0; i < w; ++i) {
-                    int ha = z->img_comp[n].ha;
-                    if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2*j * 8 + i * 8, z->img_comp[n].w2, data);
-                    // every data block is an MCU, so countdown the restart interval
-                    if (--z->todo <= 0) {
-                        if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                        // if it's NOT a restart, then just bail, so we get corrupt data
-                        // rather than no data
-                        if (!STBI__RESTART(z->marker)) return 1;
-                        stbi__jpeg_reset(z);
-                    }
-                }
+    int i, j, x, y, n = z->block_size, r, shift;
+    STBI_SIMD_ALIGN(stbi_uc, block[64]);
+
+    if (n == 8) {
+        z->idct_block_kernel(out, out_stride, data);
+        return;
+    }
+    if (n == 1) {
+        out[0] = stbi__clamp(((data[0] + 4) >> 3) + 128);
+        return;
+    }
+    z->idct_block_kernel(block, 8, data);
+    r = 8 / n;
+    shift = r == 2 ? 2 : 4;
+    for (j = 0; j < n; ++j, out += out_stride) {
+        for (i = 0; i < n; ++i) {
+            int sum = 1 << (shift - 1);
+            for (y = 0; y < r; ++y)
+                for (x = 0; x < r; ++x)
+                    sum += block[(j * r + y) * 8 + i * r + x];
+            out[i] = (stbi_uc)(sum >> shift);
+        }
+    }
+}
+
+// decode baseline MCUs [mcu_start, mcu_end) of the current scan, in scan order.
+// for non-interleaved scans every 8x8 block of the component counts as an MCU.
+static int stbi__jpeg_decode_baseline_mcus(stbi__jpeg *z, int mcu_start, int mcu_end)
+{
+    STBI_SIMD_ALIGN(short, data[64]);
+    int i, j, m;
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        int ha = z->img_comp[n].ha;
+        // non-interleaved data, we just need to process one block at a time,
+        // in trivial scanline order
+        // number of blocks to do just depends on how many actual "pixels" this
+        // component has, independent of interleaved MCU blocking and such
+        int w = (z->img_comp[n].x + 7) >> 3;
+        i = mcu_start % w;
+        j = mcu_start / w;
+        for (m = mcu_start; m < mcu_end; ++m) {
+            if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+            stbi__jpeg_idct(z, z->img_comp[n].data + (z->img_comp[n].w2*j + i) * z->block_size, z->img_comp[n].w2, data);
+            // every data block is an MCU, so countdown the restart interval
+            if (--z->todo <= 0) {
+                if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+                // if it's NOT a restart, then just bail, so we get corrupt data
+                // rather than no data
+                if (!STBI__RESTART(z->marker)) return 1;
+                stbi__jpeg_reset(z);
             }
-            return 1;
+            if (++i == w) { i = 0; ++j; }
         }
-        else { // interleaved
-            int i, j, k, x, y;
-            STBI_SIMD_ALIGN(short, data[64]);
-            for (j = 0; j < z->img_mcu_y; ++j) {
-                for (i = 0; i < z->img_mcu_x; ++i) {
-                    // scan an interleaved mcu... process scan_n components in order
-                    for (k = 0; k < z->scan_n; ++k) {
-                        int n = z->order[k];
-                        // scan out an mcu's worth of this component; that's just determined
-                        // by the basic H and V specified for the component
-                        for (y = 0; y < z->img_comp[n].v; ++y) {
-                            for (x = 0; x < z->img_comp[n].h; ++x) {
-                                int x2 = (i*z->img_comp[n].h + x) * 8;
-                                int y2 = (j*z->img_comp[n].v + y) * 8;
-                                int ha = z->img_comp[n].ha;
-                                if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                                z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2*y2 + x2, z->img_comp[n].w2, data);
-                            }
-                        }
-                    }
-                    // after all interleaved components, that's an interleaved MCU,
-                    // so now count down the restart interval
-                    if (--z->todo <= 0) {
-                        if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                        if (!STBI__RESTART(z->marker)) return 1;
-                        stbi__jpeg_reset(z);
+        return 1;
+    }
+    else { // interleaved
+        int k, x, y;
+        i = mcu_start % z->img_mcu_x;
+        j = mcu_start / z->img_mcu_x;
+        for (m = mcu_start; m < mcu_end; ++m) {
+            // scan an interleaved mcu... process scan_n components in order
+            for (k = 0; k < z->scan_n; ++k) {
+                int n = z->order[k];
+                // scan out an mcu's worth of this component; that's just determined
+                // by the basic H and V specified for the component
+                for (y = 0; y < z->img_comp[n].v; ++y) {
+                    for (x = 0; x < z->img_comp[n].h; ++x) {
+                        int x2 = (i*z->img_comp[n].h + x) * z->block_size;
+                        int y2 = (j*z->img_comp[n].v + y) * z->block_size;
+                        int ha = z->img_comp[n].ha;
+                        if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd, z->huff_ac + ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                        stbi__jpeg_idct(z, z->img_comp[n].data + z->img_comp[n].w2*y2 + x2, z->img_comp[n].w2, data);
                     }
                 }
             }
-            return 1;
+            // after all interleaved components, that's an interleaved MCU,
+            // so now count down the restart interval
+            if (--z->todo <= 0) {
+                if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+                if (!STBI__RESTART(z->marker)) return 1;
+                stbi__jpeg_reset(z);
+            }
+            if (++i == z->img_mcu_x) { i = 0; ++j; }
+        }
+        return 1;
+    }
+}
+
+// number of MCUs in the current scan
+static int stbi__jpeg_scan_mcus(stbi__jpeg *z)
+{
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        return ((z->img_comp[n].x + 7) >> 3) * ((z->img_comp[n].y + 7) >> 3);
+    }
+    return z->img_mcu_x * z->img_mcu_y;
+}
+
+#ifndef STBI_NO_THREADS
+typedef struct
+{
+    stbi__jpeg *z;
+    stbi__jpeg *copies; // one private decoder per thread, allocated up front
+    stbi_uc **interval; // start of each restart interval; interval[count] is the end of the scan
+    int count;          // number of restart intervals in the scan
+    int mcus;           // number of MCUs in the scan
+} stbi__jpeg_slices;
+
+// decode a contiguous run of restart intervals with a private copy of the decoder
+static int stbi__jpeg_slice_worker(void *job, int index, int count)
+{
+    stbi__jpeg_slices *sl = (stbi__jpeg_slices *)job;
+    int ri = sl->z->restart_interval;
+    int a = sl->count * index / count;
+    int b = sl->count * (index + 1) / count;
+    int last = b * ri < sl->mcus ? b * ri : sl->mcus;
+    stbi__context s;
+    stbi__jpeg *j = &sl->copies[index];
+
+    if (a >= b) return 1;
+    memcpy(j, sl->z, sizeof(*j));
+    stbi__start_mem(&s, sl->interval[a], (int)(sl->interval[b] - sl->interval[a]));
+    j->s = &s;
+    stbi__jpeg_reset(j);
+    return stbi__jpeg_decode_baseline_mcus(j, a * ri, last);
+}
+
+// split a baseline scan at its RST markers and decode the pieces on worker
+// threads. every interval writes its own blocks, so no locking is needed.
+// returns -1 (and consumes nothing) if the scan isn't cleanly sliceable.
+static int stbi__jpeg_parse_entropy_coded_data_parallel(stbi__jpeg *z)
+{
+    stbi__context *s = z->s;
+    stbi__jpeg_slices sl;
+    stbi_uc *p, *end;
+    int n = 0, threads, ok;
+
+    // slicing needs the whole scan in memory
+    if (s->io.read) return -1;
+
+    sl.mcus = stbi__jpeg_scan_mcus(z);
+    sl.count = (sl.mcus + z->restart_interval - 1) / z->restart_interval;
+    if (sl.count < 2) return -1;
+    sl.interval = (stbi_uc **)stbi__malloc_mad2(sl.count + 1, sizeof(stbi_uc *), 0);
+    if (!sl.interval) return -1;
+
+    // walk the entropy-coded data for RSTn; any other marker ends the scan
+    p = s->img_buffer;
+    end = s->img_buffer_end;
+    sl.interval[n++] = p;
+    while (p + 1 < end) {
+        if (p[0] != 0xff) { ++p; continue; }
+        if (p[1] == 0x00) { p += 2; continue; } // stuffed 0xff data byte
+        if (p[1] == 0xff) { ++p; continue; }    // fill byte before a marker
+        if (!STBI__RESTART(p[1]) || n == sl.count) break;
+        p += 2;
+        sl.interval[n++] = p;
+    }
+    if (n != sl.count) {
+        // missing or extra restart markers; let the serial decoder deal with it
+        stbi__free(sl.interval);
+        return -1;
+    }
+    sl.interval[n] = p < end ? p : end;
+
+    sl.z = z;
+    threads = s->num_threads < sl.count ? s->num_threads : sl.count;
+    sl.copies = (stbi__jpeg *)stbi__malloc_mad2(threads, sizeof(stbi__jpeg), 0);
+    if (!sl.copies) {
+        stbi__free(sl.interval);
+        return -1;
+    }
+    ok = stbi__run_workers(stbi__jpeg_slice_worker, &sl, threads);
+    stbi__free(sl.copies);
+
+    // leave the stream where the serial decoder would: at the marker after the scan
+    s->img_buffer = sl.interval[n];
+    z->marker = STBI__MARKER_none;
+    stbi__free(sl.interval);
+    return ok;
+}
+#endif
+
+static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+{
+    stbi__jpeg_reset(z);
+    if (!z->progressive) {
+#ifndef STBI_NO_THREADS
+        // restart intervals can be entropy-decoded independently; the parallel
+        // path returns -1 if this scan can't be sliced and we go serial instead
+        if (z->s->num_threads > 1 && z->restart_interval) {
+            int r = stbi__jpeg_parse_entropy_coded_data_parallel(z);
+            if (r >= 0) return r;
         }
+#endif
+        return stbi__jpeg_decode_baseline_mcus(z, 0, stbi__jpeg_scan_mcus(z));
     }
     else {
         if (z->scan_n == 1) {
@@ -2848,17 +4041,19 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
     }
 }
 
-static void stbi__jpeg_dequantize(short *data, stbi_uc *dequant)
+static void stbi__jpeg_dequantize(short *out, short *data, stbi_uc *dequant)
 {
     int i;
     for (i = 0; i < 64; ++i)
-        data[i] *= dequant[i];
+        out[i] = data[i] * dequant[i];
 }
 
+// leaves the coefficients alone, so a stream can call this after every scan
 static void stbi__jpeg_finish(stbi__jpeg *z)
 {
     if (z->progressive) {
         // dequantize and idct the data
+        STBI_SIMD_ALIGN(short, block[64]);
         int i, j, n;
         for (n = 0; n < z->s->img_n; ++n) {
             int w = (z->img_comp[n].x + 7) >> 3;
@@ -2866,8 +4061,8 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (j = 0; j < h; ++j) {
                 for (i = 0; i < w; ++i) {
                     short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
-                    stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2*j * 8 + i * 8, z->img_comp[n].w2, data);
+                    stbi__jpeg_dequantize(block, data, z->dequant[z->img_comp[n].tq]);
+                    stbi__jpeg_idct(z, z->img_comp[n].data + (z->img_comp[n].w2*j + i) * z->block_size, z->img_comp[n].w2, block);
                 }
             }
         }
@@ -2984,17 +4179,17 @@ static int stbi__free_jpeg_components(stbi__jpeg *z, int ncomp, int why)
     int i;
     for (i = 0; i < ncomp; ++i) {
         if (z->img_comp[i].raw_data) {
-            STBI_FREE(z->img_comp[i].raw_data);
+            stbi__free(z->img_comp[i].raw_data);
             z->img_comp[i].raw_data = NULL;
             z->img_comp[i].data = NULL;
         }
         if (z->img_comp[i].raw_coeff) {
-            STBI_FREE(z->img_comp[i].raw_coeff);
+            stbi__free(z->img_comp[i].raw_coeff);
             z->img_comp[i].raw_coeff = 0;
             z->img_comp[i].coeff = 0;
         }
         if (z->img_comp[i].linebuf) {
-            STBI_FREE(z->img_comp[i].linebuf);
+            stbi__free(z->img_comp[i].linebuf);
             z->img_comp[i].linebuf = NULL;
         }
     }
@@ -3065,8 +4260,8 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
         //
         // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
         // so these muls can't overflow with 32-bit ints (which we require)
-        z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-        z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+        z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * z->block_size;
+        z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * z->block_size;
         z->img_comp[i].coeff = 0;
         z->img_comp[i].raw_coeff = 0;
         z->img_comp[i].linebuf = NULL;
@@ -3076,10 +4271,9 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
         // align blocks for idct using mmx/sse
         z->img_comp[i].data = (stbi_uc*)(((size_t)z->img_comp[i].raw_data + 15) & ~15);
         if (z->progressive) {
-            // w2, h2 are multiples of 8 (see above)
-            z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-            z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-            z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+            z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+            z->img_comp[i].coeff_h = z->img_mcu_y * z->img_comp[i].v;
+            z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
             if (z->img_comp[i].raw_coeff == NULL)
                 return stbi__free_jpeg_components(z, i + 1, stbi__err("outofmem", "Out of memory"));
             z->img_comp[i].coeff = (short*)(((size_t)z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3121,6 +4315,21 @@ static int stbi__decode_jpeg_header(stbi__jpeg *z, int scan)
 }
 
 // decode image to YCbCr format
+// skip the entropy-coded data of a scan, leaving the marker that ends it in j->marker
+static int stbi__jpeg_skip_scan(stbi__jpeg *j)
+{
+    int x;
+    while (!stbi__at_eof(j->s)) {
+        if (stbi__get8(j->s) != 0xff) continue;
+        do x = stbi__get8(j->s); while (x == 0xff && !stbi__at_eof(j->s));
+        if (x != 0 && !STBI__RESTART(x)) {
+            j->marker = (stbi_uc)x;
+            return 1;
+        }
+    }
+    return stbi__err("no marker after scan", "Corrupt JPEG");
+}
+
 static int stbi__decode_jpeg_image(stbi__jpeg *j)
 {
     int m;
@@ -3134,7 +4343,11 @@ static int stbi__decode_jpeg_image(stbi__jpeg *j)
     while (!stbi__EOI(m)) {
         if (stbi__SOS(m)) {
             if (!stbi__process_scan_header(j)) return 0;
-            if (!stbi__parse_entropy_coded_data(j)) return 0;
+            if (j->progressive && j->block_size == 1 && j->spec_start != 0) {
+                // a 1/8 decode keeps only DC terms, so AC scans are skipped unread
+                if (!stbi__jpeg_skip_scan(j)) return 0;
+            }
+            else if (!stbi__parse_entropy_coded_data(j)) return 0;
             if (j->marker == STBI__MARKER_none) {
                 // handle 0s at the end of image data from IP Kamera 9060
                 while (!stbi__at_eof(j->s)) {
@@ -3357,6 +4570,80 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+STBI__AVX2_TARGET
+static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+    // same filter as stbi__resample_row_hv_2_simd, 16 pixels at a time
+    int i = 0, t0, t1;
+
+    if (w == 1) {
+        out[0] = out[1] = stbi__div4(3 * in_near[0] + in_far[0] + 2);
+        return out;
+    }
+
+    t1 = 3 * in_near[0] + in_far[0];
+    for (; i < ((w - 1) & ~15); i += 16) {
+        // vertical filtering pass: 3*x + y = 4*x + (y - x)
+        __m256i farw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+        __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+        __m256i diff = _mm256_sub_epi16(farw, nearw);
+        __m256i nears = _mm256_slli_epi16(nearw, 2);
+        __m256i curr = _mm256_add_epi16(nears, diff); // current row
+
+        // "prev"/"next" are the current row shifted by one pixel. alignr only
+        // shifts within 128-bit lanes, so pair it with a lane-swapped copy
+        // to carry the pixel across the middle.
+        __m256i lo_up = _mm256_permute2x128_si256(curr, curr, 0x08); // [0, curr.lo]
+        __m256i hi_dn = _mm256_permute2x128_si256(curr, curr, 0x81); // [curr.hi, 0]
+        __m256i prv0 = _mm256_alignr_epi8(curr, lo_up, 14);
+        __m256i nxt0 = _mm256_alignr_epi8(hi_dn, curr, 2);
+        __m256i prev = _mm256_insert_epi16(prv0, t1, 0);
+        __m256i next = _mm256_insert_epi16(nxt0, 3 * in_near[i + 16] + in_far[i + 16], 15);
+
+        // horizontal filter, polyphase:
+        // even pixels = cur*4 + (prev - cur), odd pixels = cur*4 + (next - cur)
+        __m256i bias = _mm256_set1_epi16(8);
+        __m256i curs = _mm256_slli_epi16(curr, 2);
+        __m256i prvd = _mm256_sub_epi16(prev, curr);
+        __m256i nxtd = _mm256_sub_epi16(next, curr);
+        __m256i curb = _mm256_add_epi16(curs, bias);
+        __m256i even = _mm256_add_epi16(prvd, curb);
+        __m256i odd = _mm256_add_epi16(nxtd, curb);
+
+        // interleave even and odd pixels, then undo scaling. unpack and pack
+        // both work per lane, so each lane ends up with 8 whole input pixels.
+        __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+        __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+        __m256i de0 = _mm256_srli_epi16(int0, 4);
+        __m256i de1 = _mm256_srli_epi16(int1, 4);
+
+        // pack and write output
+        __m256i outv = _mm256_packus_epi16(de0, de1);
+        _mm256_storeu_si256((__m256i *) (out + i * 2), outv);
+
+        // "previous" value for next iter
+        t1 = 3 * in_near[i + 15] + in_far[i + 15];
+    }
+
+    t0 = t1;
+    t1 = 3 * in_near[i] + in_far[i];
+    out[i * 2] = stbi__div16(3 * t1 + t0 + 8);
+
+    for (++i; i < w; ++i) {
+        t0 = t1;
+        t1 = 3 * in_near[i] + in_far[i];
+        out[i * 2 - 1] = stbi__div16(3 * t0 + t1 + 8);
+        out[i * 2] = stbi__div16(3 * t1 + t0 + 8);
+    }
+    out[w * 2 - 1] = stbi__div4(t1 + 2);
+
+    STBI_NOTUSED(hs);
+
+    return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
     // resample with nearest-neighbor
@@ -3561,6 +4848,74 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+STBI__AVX2_TARGET
+static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+    int i = 0;
+
+    // same math as the SSE2 loop in stbi__YCbCr_to_RGB_simd, 16 pixels at
+    // a time; whatever is left over goes through that function.
+    if (step == 4) {
+        __m128i signflip = _mm_set1_epi8(-0x80);
+        __m256i cr_const0 = _mm256_set1_epi16((short)(1.40200f*4096.0f + 0.5f));
+        __m256i cr_const1 = _mm256_set1_epi16(-(short)(0.71414f*4096.0f + 0.5f));
+        __m256i cb_const0 = _mm256_set1_epi16(-(short)(0.34414f*4096.0f + 0.5f));
+        __m256i cb_const1 = _mm256_set1_epi16((short)(1.77200f*4096.0f + 0.5f));
+        __m256i y_bias = _mm256_set1_epi16(128);
+        __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+        for (; i + 15 < count; i += 16) {
+            // load
+            __m128i y_bytes = _mm_loadu_si128((__m128i *) (y + i));
+            __m128i cr_bytes = _mm_loadu_si128((__m128i *) (pcr + i));
+            __m128i cb_bytes = _mm_loadu_si128((__m128i *) (pcb + i));
+            __m128i cr_biased = _mm_xor_si128(cr_bytes, signflip); // -128
+            __m128i cb_biased = _mm_xor_si128(cb_bytes, signflip); // -128
+
+            // unpack to short (and left-shift cr, cb by 8)
+            __m256i yw = _mm256_or_si256(_mm256_slli_epi16(_mm256_cvtepu8_epi16(y_bytes), 8), y_bias);
+            __m256i crw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cr_biased), 8);
+            __m256i cbw = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cb_biased), 8);
+
+            // color transform
+            __m256i yws = _mm256_srli_epi16(yw, 4);
+            __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+            __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+            __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+            __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+            __m256i rws = _mm256_add_epi16(cr0, yws);
+            __m256i gwt = _mm256_add_epi16(cb0, yws);
+            __m256i bws = _mm256_add_epi16(yws, cb1);
+            __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+            // descale
+            __m256i rw = _mm256_srai_epi16(rws, 4);
+            __m256i bw = _mm256_srai_epi16(bws, 4);
+            __m256i gw = _mm256_srai_epi16(gws, 4);
+
+            // back to byte, set up for transpose
+            __m256i brb = _mm256_packus_epi16(rw, bw);
+            __m256i gxb = _mm256_packus_epi16(gw, xw);
+
+            // transpose to interleave channels; lanes hold pixels 0-3|8-11
+            // in o0 and 4-7|12-15 in o1
+            __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+            __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+            __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+            __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+            // store
+            _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+            out += 64;
+        }
+    }
+
+    stbi__YCbCr_to_RGB_simd(out, y + i, pcb + i, pcr + i, count - i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
@@ -3575,44 +4930,177 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
         j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
 #endif
         j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+#ifdef STBI_AVX2
+        if (stbi__avx2_available()) {
+            j->idct_block_kernel = stbi__idct_avx2;
+#ifndef STBI_JPEG_OLD
+            j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+#endif
+            j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+        }
+#endif
+    }
+#endif
+
+#ifdef STBI_NEON
+    j->idct_block_kernel = stbi__idct_simd;
+#ifndef STBI_JPEG_OLD
+    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+#endif
+    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+#endif
+
+    // a scaled decode writes each 8x8 block as a smaller one
+    j->block_size = 8 / j->s->jpeg_scale;
+}
+
+// clean up the temporary component buffers
+static void stbi__cleanup_jpeg(stbi__jpeg *j)
+{
+    stbi__free_jpeg_components(j, j->s->img_n, 0);
+}
+
+typedef struct
+{
+    resample_row_func resample;
+    stbi_uc *line0, *line1;
+    int hs, vs;   // expansion factor in each axis
+    int w_lores; // horizontal pixels pre-expansion
+    int ystep;   // how far through vertical expansion we are
+    int ypos;    // which pre-expansion row we're on
+} stbi__resample;
+
+// resample and color-convert output rows [j0,j1) to 'output' (which holds row j0);
+// res_comp must already be at row j0. note the 3-channel converters store one
+// byte past the end of each row.
+static void stbi__jpeg_convert_rows(stbi__jpeg *z, stbi_uc *output, int out_stride, int n, int decode_n, stbi__resample *res_comp, stbi_uc **linebuf, unsigned int j0, unsigned int j1)
+{
+    int k;
+    unsigned int i, j;
+    stbi_uc *coutput[4];
+
+    for (j = j0; j < j1; ++j, output += out_stride) {
+        stbi_uc *out = output;
+        for (k = 0; k < decode_n; ++k) {
+            stbi__resample *r = &res_comp[k];
+            int y_bot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(linebuf[k],
+                y_bot ? r->line1 : r->line0,
+                y_bot ? r->line0 : r->line1,
+                r->w_lores, r->hs);
+            if (++r->ystep >= r->vs) {
+                r->ystep = 0;
+                r->line0 = r->line1;
+                if (++r->ypos < z->img_comp[k].y)
+                    r->line1 += z->img_comp[k].w2;
+            }
+        }
+        if (n >= 3) {
+            stbi_uc *y = coutput[0];
+            if (z->s->img_n == 3) {
+                if (z->rgb == 3) {
+                    for (i = 0; i < z->s->img_x; ++i) {
+                        out[0] = y[i];
+                        out[1] = coutput[1][i];
+                        out[2] = coutput[2][i];
+                        if (n == 4) out[3] = 255;
+                        out += n;
+                    }
+                }
+                else if (n == 4) {
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
+                }
+                else {
+                    // the kernels write a fourth byte even for 3-channel output;
+                    // keep the last pixel's from spilling past the end of the row
+                    stbi_uc last[4];
+                    i = z->s->img_x - 1;
+                    z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], i, n);
+                    z->YCbCr_to_RGB_kernel(last, y + i, coutput[1] + i, coutput[2] + i, 1, 4);
+                    memcpy(out + i * 3, last, 3);
+                }
+            }
+            else
+                for (i = 0; i < z->s->img_x; ++i) {
+                    out[0] = out[1] = out[2] = y[i];
+                    if (n == 4) out[3] = 255;
+                    out += n;
+                }
+        }
+        else {
+            stbi_uc *y = coutput[0];
+            if (n == 1)
+                for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
+            else
+                for (i = 0; i < z->s->img_x; ++i) *out++ = y[i], *out++ = 255;
+        }
     }
-#endif
-
-#ifdef STBI_NEON
-    j->idct_block_kernel = stbi__idct_simd;
-#ifndef STBI_JPEG_OLD
-    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-#endif
-    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
-#endif
 }
 
-// clean up the temporary component buffers
-static void stbi__cleanup_jpeg(stbi__jpeg *j)
+#ifndef STBI_NO_THREADS
+// advance a resampler past 'rows' output rows without producing them
+static void stbi__resample_skip_rows(stbi__resample *r, int comp_y, int w2, unsigned int rows)
 {
-    stbi__free_jpeg_components(j, j->s->img_n, 0);
+    for (; rows > 0; --rows) {
+        if (++r->ystep >= r->vs) {
+            r->ystep = 0;
+            r->line0 = r->line1;
+            if (++r->ypos < comp_y)
+                r->line1 += w2;
+        }
+    }
 }
 
 typedef struct
 {
-    resample_row_func resample;
-    stbi_uc *line0, *line1;
-    int hs, vs;   // expansion factor in each axis
-    int w_lores; // horizontal pixels pre-expansion
-    int ystep;   // how far through vertical expansion we are
-    int ypos;    // which pre-expansion row we're on
-} stbi__resample;
-
-static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
-{
+    stbi__jpeg *z;
+    stbi_uc *output;          // row 0
+    int out_stride;           // negative when flipping into a target
     int n, decode_n;
-    z->s->img_n = 0; // make stbi__cleanup_jpeg safe
+    stbi__resample *res_comp; // resampler state at row 0
+    stbi_uc *scratch;         // 'scratch_size' bytes of line buffers per thread
+    int scratch_size;
+} stbi__jpeg_convert_job;
+
+// convert one horizontal band of the output with private line buffers
+static int stbi__jpeg_convert_worker(void *job, int index, int count)
+{
+    stbi__jpeg_convert_job *c = (stbi__jpeg_convert_job *)job;
+    stbi__jpeg *z = c->z;
+    unsigned int j0 = z->s->img_y * index / count;
+    unsigned int j1 = z->s->img_y * (index + 1) / count;
+    stbi__resample r[4];
+    stbi_uc *linebuf[4];
+    stbi_uc *buf;
+    int k;
 
-                     // validate req_comp
-    if (req_comp < 0 || req_comp > 4) return stbi__errpuc("bad req_comp", "Internal error");
+    if (j0 >= j1) return 1;
+    buf = c->scratch + c->scratch_size * index;
+    for (k = 0; k < c->decode_n; ++k) {
+        r[k] = c->res_comp[k];
+        stbi__resample_skip_rows(&r[k], z->img_comp[k].y, z->img_comp[k].w2, j0);
+        linebuf[k] = buf + k * (z->s->img_x + 3);
+    }
+    // rows never write past their last pixel, so bands can't touch each other
+    stbi__jpeg_convert_rows(z, c->output + (ptrdiff_t)c->out_stride * j0, c->out_stride, c->n, c->decode_n, r, linebuf, j0, j1);
+    return 1;
+}
+#endif
 
-    // load a jpeg image from whichever source, but leave in YCbCr format
-    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
+static void stbi__jpeg_free_linebufs(stbi__jpeg *z, int n)
+{
+    int k;
+    for (k = 0; k < n; ++k) {
+        stbi__free(z->img_comp[k].linebuf);
+        z->img_comp[k].linebuf = NULL;
+    }
+}
+
+// resample and color-convert the decoded component planes into a new image
+// (or the context's target). the planes are left alone.
+static stbi_uc *stbi__jpeg_output(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+{
+    int n, decode_n;
 
     // determine actual number of components to generate
     n = req_comp ? req_comp : z->s->img_n;
@@ -3624,10 +5112,9 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
 
     // resample and color-convert
     {
-        int k;
-        unsigned int i, j;
+        int k, threads = 1, out_stride;
         stbi_uc *output;
-        stbi_uc *coutput[4];
+        stbi_uc *linebuf[4];
 
         stbi__resample res_comp[4];
 
@@ -3637,7 +5124,8 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
             // allocate line buffer big enough for upsampling off the edges
             // with upsample factor of 4
             z->img_comp[k].linebuf = (stbi_uc *)stbi__malloc(z->s->img_x + 3);
-            if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+            if (!z->img_comp[k].linebuf) { stbi__jpeg_free_linebufs(z, k); return stbi__errpuc("outofmem", "Out of memory"); }
+            linebuf[k] = z->img_comp[k].linebuf;
 
             r->hs = z->img_h_max / z->img_comp[k].h;
             r->vs = z->img_v_max / z->img_comp[k].v;
@@ -3653,59 +5141,47 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
             else                               r->resample = stbi__resample_row_generic;
         }
 
-        // can't error after this so, this is safe
-        output = (stbi_uc *)stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
-        if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
-
-        // now go ahead and resample
-        for (j = 0; j < z->s->img_y; ++j) {
-            stbi_uc *out = output + n * z->s->img_x * j;
-            for (k = 0; k < decode_n; ++k) {
-                stbi__resample *r = &res_comp[k];
-                int y_bot = r->ystep >= (r->vs >> 1);
-                coutput[k] = r->resample(z->img_comp[k].linebuf,
-                    y_bot ? r->line1 : r->line0,
-                    y_bot ? r->line0 : r->line1,
-                    r->w_lores, r->hs);
-                if (++r->ystep >= r->vs) {
-                    r->ystep = 0;
-                    r->line0 = r->line1;
-                    if (++r->ypos < z->img_comp[k].y)
-                        r->line1 += z->img_comp[k].w2;
-                }
+        // rows go out bottom-up when flipping, so there's no flip pass afterwards
+        output = stbi__alloc_rows(z->s, z->s->img_x, z->s->img_y, n, &out_stride);
+        if (!output) { stbi__jpeg_free_linebufs(z, decode_n); return NULL; }
+
+        // now go ahead and resample; bands of fewer than 16 rows aren't worth a thread
+#ifndef STBI_NO_THREADS
+        threads = z->s->num_threads;
+        if (threads > (int)(z->s->img_y / 16)) threads = (int)(z->s->img_y / 16);
+        if (threads > 1) {
+            stbi__jpeg_convert_job job;
+            int ok;
+            job.z = z;
+            job.output = output;
+            job.out_stride = out_stride;
+            job.n = n;
+            job.decode_n = decode_n;
+            job.res_comp = res_comp;
+            // workers don't allocate (the caller's arena is thread-local), so
+            // their line buffers come from here
+            job.scratch = NULL;
+            if (stbi__mad2sizes_valid(decode_n, z->s->img_x + 3, 0)) {
+                job.scratch_size = decode_n * (z->s->img_x + 3);
+                job.scratch = (stbi_uc *)stbi__malloc_mad2(threads, job.scratch_size, 0);
             }
-            if (n >= 3) {
-                stbi_uc *y = coutput[0];
-                if (z->s->img_n == 3) {
-                    if (z->rgb == 3) {
-                        for (i = 0; i < z->s->img_x; ++i) {
-                            out[0] = y[i];
-                            out[1] = coutput[1][i];
-                            out[2] = coutput[2][i];
-                            out[3] = 255;
-                            out += n;
-                        }
-                    }
-                    else {
-                        z->YCbCr_to_RGB_kernel(out, y, coutput[1], coutput[2], z->s->img_x, n);
-                    }
-                }
-                else
-                    for (i = 0; i < z->s->img_x; ++i) {
-                        out[0] = out[1] = out[2] = y[i];
-                        out[3] = 255; // not used if n==3
-                        out += n;
-                    }
+            if (!job.scratch) {
+                stbi__free_rows(z->s);
+                stbi__jpeg_free_linebufs(z, decode_n);
+                return stbi__errpuc("outofmem", "Out of memory");
             }
-            else {
-                stbi_uc *y = coutput[0];
-                if (n == 1)
-                    for (i = 0; i < z->s->img_x; ++i) out[i] = y[i];
-                else
-                    for (i = 0; i < z->s->img_x; ++i) *out++ = y[i], *out++ = 255;
+            ok = stbi__run_workers(stbi__jpeg_convert_worker, &job, threads);
+            stbi__free(job.scratch);
+            if (!ok) {
+                stbi__free_rows(z->s);
+                stbi__jpeg_free_linebufs(z, decode_n);
+                return NULL;
             }
         }
-        stbi__cleanup_jpeg(z);
+#endif
+        if (threads <= 1)
+            stbi__jpeg_convert_rows(z, output, out_stride, n, decode_n, res_comp, linebuf, 0, z->s->img_y);
+        stbi__jpeg_free_linebufs(z, decode_n);
         *out_x = z->s->img_x;
         *out_y = z->s->img_y;
         if (comp) *comp = z->s->img_n; // report original components, not output
@@ -3713,14 +5189,42 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
     }
 }
 
+static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+{
+    stbi_uc *output;
+    z->s->img_n = 0; // make stbi__cleanup_jpeg safe
+
+                     // validate req_comp
+    if (req_comp < 0 || req_comp > 4) return stbi__errpuc("bad req_comp", "Internal error");
+
+    // load a jpeg image from whichever source, but leave in YCbCr format
+    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
+
+    // from here on the image is the size it was decoded at
+    if (z->block_size != 8) {
+        int k, scale = 8 / z->block_size;
+        z->s->img_x = (z->s->img_x + scale - 1) / scale;
+        z->s->img_y = (z->s->img_y + scale - 1) / scale;
+        for (k = 0; k < z->s->img_n; ++k) {
+            z->img_comp[k].x = (z->img_comp[k].x + scale - 1) / scale;
+            z->img_comp[k].y = (z->img_comp[k].y + scale - 1) / scale;
+        }
+    }
+
+    output = stbi__jpeg_output(z, out_x, out_y, comp, req_comp);
+    stbi__cleanup_jpeg(z);
+    return output;
+}
+
 static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri)
 {
     unsigned char* result;
     stbi__jpeg* j = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    if (!j) return stbi__errpuc("outofmem", "Out of memory");
     j->s = s;
     stbi__setup_jpeg(j);
     result = load_jpeg_image(j, x, y, comp, req_comp);
-    STBI_FREE(j);
+    stbi__free(j);
     return result;
 }
 
@@ -3741,8 +5245,8 @@ static int stbi__jpeg_info_raw(stbi__jpeg *j, int *x, int *y, int *comp)
         stbi__rewind(j->s);
         return 0;
     }
-    if (x) *x = j->s->img_x;
-    if (y) *y = j->s->img_y;
+    if (x) *x = (j->s->img_x + j->s->jpeg_scale - 1) / j->s->jpeg_scale;
+    if (y) *y = (j->s->img_y + j->s->jpeg_scale - 1) / j->s->jpeg_scale;
     if (comp) *comp = j->s->img_n;
     return 1;
 }
@@ -3751,11 +5255,303 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 {
     int result;
     stbi__jpeg* j = (stbi__jpeg*)(stbi__malloc(sizeof(stbi__jpeg)));
+    if (!j) return stbi__err("outofmem", "Out of memory");
     j->s = s;
     result = stbi__jpeg_info_raw(j, x, y, comp);
-    STBI_FREE(j);
+    stbi__free(j);
     return result;
 }
+
+// incremental decoding (stbi_jpeg_stream_*): bytes are buffered until a
+// whole marker segment, or a whole scan, has arrived, and each one is then
+// handed to the regular decoder. progressive coefficients accumulate in
+// z->img_comp[].coeff between scans exactly as in a one-shot decode.
+
+enum
+{
+    STBI__STREAM_soi,    // waiting for SOI
+    STBI__STREAM_frame,  // tables before SOF
+    STBI__STREAM_scans,
+    STBI__STREAM_done,
+    STBI__STREAM_error
+};
+
+struct stbi_jpeg_stream
+{
+    stbi__context s;
+    stbi__jpeg *z;
+    stbi_uc *buffer;  // bytes fed but not decoded yet start at buffer + pos
+    int pos, len, cap;
+    int search;       // how far the pending scan has been searched for its end
+    int state;
+    int req_comp;
+    int dc_seen;      // components whose first DC scan has been decoded
+    int ac_seen;      // an AC scan has been decoded, so full size beats the DC preview
+};
+
+// decode the next segment if all of it has arrived: returns 3 if that was a
+// scan that changed the picture, 2 for any other segment, 1 if more data is
+// needed, 0 on error
+static int stbi__jpeg_stream_step(stbi_jpeg_stream *js)
+{
+    stbi__jpeg *z = js->z;
+    stbi__context *s = &js->s;
+    stbi_uc *p = js->buffer + js->pos, *end = js->buffer + js->len, *seg;
+    int m, L, k;
+
+    if (z->marker != STBI__MARKER_none) {
+        // the last scan ran into this marker while filling its bit buffer
+        m = z->marker;
+        seg = p;
+    }
+    else {
+        // padding is allowed before SOF (as in stbi__decode_jpeg_header), and
+        // zeros after a scan (as in stbi__decode_jpeg_image)
+        while (p < end && *p != 0xff) {
+            if (js->state == STBI__STREAM_soi) return stbi__err("no SOI", "Corrupt JPEG");
+            if (js->state == STBI__STREAM_scans && *p != 0) return stbi__err("junk before marker", "Corrupt JPEG");
+            ++p;
+        }
+        while (p < end && *p == 0xff)
+            ++p;
+        if (p == end) return 1;
+        m = *p;
+        seg = p + 1;
+    }
+
+    if (js->state == STBI__STREAM_soi) {
+        if (!stbi__SOI(m)) return stbi__err("no SOI", "Corrupt JPEG");
+        js->pos = (int)(seg - js->buffer);
+        js->state = STBI__STREAM_frame;
+        return 2;
+    }
+    if (stbi__EOI(m)) {
+        if (js->state != STBI__STREAM_scans) return stbi__err("no SOF", "Corrupt JPEG");
+        z->marker = STBI__MARKER_none;
+        js->pos = (int)(seg - js->buffer);
+        js->state = STBI__STREAM_done;
+        return 2;
+    }
+
+    // every other marker we accept is followed by a length
+    if (end - seg < 2) return 1;
+    L = (seg[0] << 8) | seg[1];
+    if (end - seg < L) return 1;
+
+    if (stbi__SOS(m)) {
+        stbi_uc *q = js->search ? js->buffer + js->search : seg + L;
+        if (js->state != STBI__STREAM_scans) return stbi__err("no SOF", "Corrupt JPEG");
+        // the entropy-coded data runs up to the first marker that isn't RSTn
+        while (q + 1 < end) {
+            if (q[0] != 0xff) { ++q; continue; }
+            if (q[1] == 0x00 || STBI__RESTART(q[1])) { q += 2; continue; }
+            if (q[1] == 0xff) { ++q; continue; }
+            break;
+        }
+        if (q + 1 >= end) {
+            js->search = (int)(q - js->buffer);
+            return 1;
+        }
+        js->search = 0;
+        z->marker = STBI__MARKER_none;
+        s->img_buffer = seg;
+        s->img_buffer_end = end;
+        if (!stbi__process_scan_header(z)) return 0;
+        if (!stbi__parse_entropy_coded_data(z)) return 0;
+        js->pos = (int)(s->img_buffer - js->buffer);
+        if (!z->progressive) return 2;
+        if (z->spec_start == 0) {
+            if (z->succ_high == 0)
+                for (k = 0; k < z->scan_n; ++k)
+                    js->dc_seen |= 1 << z->order[k];
+        }
+        else
+            js->ac_seen = 1;
+        return js->dc_seen == (1 << s->img_n) - 1 ? 3 : 2;
+    }
+
+    z->marker = STBI__MARKER_none;
+    s->img_buffer = seg;
+    s->img_buffer_end = end;
+    if (stbi__SOF(m)) {
+        if (js->state != STBI__STREAM_frame) return stbi__err("bad SOF", "Corrupt JPEG");
+        z->progressive = stbi__SOF_progressive(m);
+        if (!stbi__process_frame_header(z, STBI__SCAN_load)) return 0;
+        js->state = STBI__STREAM_scans;
+    }
+    else if (!stbi__process_marker(z, m))
+        return 0;
+    js->pos = (int)(s->img_buffer - js->buffer);
+    return 2;
+}
+
+STBIDEF stbi_jpeg_stream *stbi_jpeg_stream_begin(stbi_load_options const *options)
+{
+    static const stbi_load_options defaults = { 0, 0, 0, NULL, 0 };
+    stbi_jpeg_stream *js;
+    int k;
+    if (!options) options = &defaults;
+    if (options->desired_channels < 0 || options->desired_channels > 4)
+        return (stbi_jpeg_stream *)stbi__errpuc("bad req_comp", "Internal error");
+    js = (stbi_jpeg_stream *)STBI_MALLOC(sizeof(*js));
+    if (!js) return (stbi_jpeg_stream *)stbi__errpuc("outofmem", "Out of memory");
+    memset(js, 0, sizeof(*js));
+    js->z = (stbi__jpeg *)STBI_MALLOC(sizeof(stbi__jpeg));
+    if (!js->z) {
+        STBI_FREE(js);
+        return (stbi_jpeg_stream *)stbi__errpuc("outofmem", "Out of memory");
+    }
+    stbi__start_mem(&js->s, js->s.buffer_start, 0);
+    js->s.flip = options->flip_vertically;
+    js->req_comp = options->desired_channels;
+    js->z->s = &js->s;
+    stbi__setup_jpeg(js->z);
+    for (k = 0; k < 4; ++k) {
+        js->z->img_comp[k].raw_data = NULL;
+        js->z->img_comp[k].raw_coeff = NULL;
+        js->z->img_comp[k].linebuf = NULL;
+    }
+    js->z->restart_interval = 0;
+    js->z->progressive = 0;
+    js->z->marker = STBI__MARKER_none;
+    js->s.img_n = 0;
+    js->state = STBI__STREAM_soi;
+    return js;
+}
+
+static int stbi__jpeg_stream_append(stbi_jpeg_stream *js, stbi_uc const *data, int len)
+{
+    if (len < 0) return stbi__err("bad len", "Negative length");
+
+    // drop what has been decoded before growing the buffer
+    if (js->pos) {
+        memmove(js->buffer, js->buffer + js->pos, js->len - js->pos);
+        js->len -= js->pos;
+        if (js->search) js->search -= js->pos;
+        js->pos = 0;
+    }
+    if (!js->buffer || len > js->cap - js->len) {
+        int cap = js->cap ? js->cap : 4096;
+        stbi_uc *buffer;
+        while (cap - js->len < len) {
+            if (cap > INT_MAX / 2) return stbi__err("too large", "Stream too large");
+            cap *= 2;
+        }
+        buffer = (stbi_uc *)STBI_REALLOC_SIZED(js->buffer, js->cap, cap);
+        if (!buffer) return stbi__err("outofmem", "Out of memory");
+        js->buffer = buffer;
+        js->cap = cap;
+    }
+    memcpy(js->buffer + js->len, data, len);
+    js->len += len;
+    return 1;
+}
+
+STBIDEF int stbi_jpeg_stream_feed(stbi_jpeg_stream *js, stbi_uc const *data, int len)
+{
+    stbi_arena *arena;
+    int r = 1, updated = 0;
+
+    if (js->state == STBI__STREAM_error) return STBI_stream_error;
+    if (js->state == STBI__STREAM_done) return STBI_stream_done;
+
+    // the stream outlives this call, so its buffers come from the heap
+    arena = stbi_set_thread_arena(NULL);
+    if (!stbi__jpeg_stream_append(js, data, len))
+        r = 0;
+    while (r && js->state != STBI__STREAM_done && (r = stbi__jpeg_stream_step(js)) >= 2)
+        updated |= r == 3;
+    stbi_set_thread_arena(arena);
+
+    if (js->state == STBI__STREAM_done) return STBI_stream_done;
+    if (!r) {
+        js->state = STBI__STREAM_error;
+        return STBI_stream_error;
+    }
+    return updated ? STBI_stream_updated : STBI_stream_more;
+}
+
+// each block's DC term is its average, so one pixel per block is the
+// image at 1/8 scale; run that through the usual upsampling and color
+// conversion as if it were a tiny image
+static stbi_uc *stbi__jpeg_dc_preview(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+{
+    stbi__jpeg *p;
+    stbi__context ps = *z->s;
+    stbi_uc *planes, *output;
+    size_t size = 0;
+    int i, j, k;
+
+    for (k = 0; k < ps.img_n; ++k)
+        size += (size_t)((z->img_comp[k].x + 7) >> 3) * ((z->img_comp[k].y + 7) >> 3);
+    p = (stbi__jpeg *)stbi__malloc(sizeof(stbi__jpeg));
+    if (!p) return stbi__errpuc("outofmem", "Out of memory");
+    planes = (stbi_uc *)stbi__malloc(size);
+    if (!planes) {
+        stbi__free(p);
+        return stbi__errpuc("outofmem", "Out of memory");
+    }
+    *p = *z;
+    p->s = &ps;
+    ps.img_x = (z->s->img_x + 7) >> 3;
+    ps.img_y = (z->s->img_y + 7) >> 3;
+    ps.num_threads = 1;
+
+    size = 0;
+    for (k = 0; k < ps.img_n; ++k) {
+        int w = (z->img_comp[k].x + 7) >> 3;
+        int h = (z->img_comp[k].y + 7) >> 3;
+        int q = z->dequant[z->img_comp[k].tq][0];
+        stbi_uc *out = planes + size;
+        for (j = 0; j < h; ++j)
+            for (i = 0; i < w; ++i)
+                out[j * w + i] = stbi__clamp(((z->img_comp[k].coeff[64 * (i + j * z->img_comp[k].coeff_w)] * q + 4) >> 3) + 128);
+        p->img_comp[k].data = out;
+        p->img_comp[k].x = w;
+        p->img_comp[k].y = h;
+        p->img_comp[k].w2 = w;
+        p->img_comp[k].linebuf = NULL;
+        size += (size_t)w * h;
+    }
+
+    output = stbi__jpeg_output(p, out_x, out_y, comp, req_comp);
+    z->s->rows = ps.rows;
+    z->s->rows_base = ps.rows_base;
+    stbi__free(planes);
+    stbi__free(p);
+    return output;
+}
+
+STBIDEF stbi_uc *stbi_jpeg_stream_image(stbi_jpeg_stream *js, int *x, int *y, int *channels_in_file, int *scale)
+{
+    stbi__jpeg *z = js->z;
+    int done = js->state == STBI__STREAM_done;
+    int preview;
+
+    if (js->state == STBI__STREAM_error) return stbi__errpuc("stream failed", "Stream hit an error");
+    if (z->progressive ? js->dc_seen != (1 << js->s.img_n) - 1 : !done)
+        return stbi__errpuc("no image yet", "Not enough of the image has arrived");
+
+    preview = z->progressive && !js->ac_seen && !done;
+    if (preview) {
+        if (!stbi__jpeg_dc_preview(z, x, y, channels_in_file, js->req_comp)) return NULL;
+    }
+    else {
+        stbi__jpeg_finish(z);
+        if (!stbi__jpeg_output(z, x, y, channels_in_file, js->req_comp)) return NULL;
+    }
+    if (scale) *scale = preview ? 8 : 1;
+    return js->s.rows_base;
+}
+
+STBIDEF void stbi_jpeg_stream_end(stbi_jpeg_stream *js)
+{
+    if (!js) return;
+    stbi__free_jpeg_components(js->z, js->s.img_n, 0);
+    STBI_FREE(js->buffer);
+    STBI_FREE(js->z);
+    STBI_FREE(js);
+}
 #endif
 
 // public domain zlib decode    v0.2  Sean Barrett 2006-11-18
@@ -3764,11 +5560,23 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 //      - all output is written to a single output buffer (can malloc/realloc)
 //    performance
 //      - fast huffman
+//      - on 64-bit little-endian targets: 64-bit bit buffer refilled 8 bytes
+//        at a time, several literals per refill, and matches copied 8 bytes
+//        at a time (define STBI_NO_ZLIB_FAST for the plain byte-at-a-time
+//        version)
 
 #ifndef STBI_NO_ZLIB
 
+#if !defined(STBI_NO_ZLIB_FAST) && (defined(STBI__X64_TARGET) || defined(_M_ARM64) || (defined(__aarch64__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))
+#define STBI__ZLIB_FAST
+#endif
+
 // fast-way is faster to check than jpeg huffman, but slow way is slower
+#ifdef STBI__ZLIB_FAST
+#define STBI__ZFAST_BITS  11 // also covers most codes in dynamic tables
+#else
 #define STBI__ZFAST_BITS  9 // accelerate all cases in default tables
+#endif
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 
 // zlib-style huffman encoding
@@ -3853,17 +5661,35 @@ static int stbi__zbuild_huffman(stbi__zhuffman *z, stbi_uc *sizelist, int num)
 //    we require PNG read all the IDATs and combine them into a single
 //    memory buffer
 
+#ifdef STBI__ZLIB_FAST
+typedef unsigned long long stbi__zbits;
+#else
+typedef stbi__uint32 stbi__zbits;
+#endif
+
 typedef struct
 {
     stbi_uc *zbuffer, *zbuffer_end;
     int num_bits;
-    stbi__uint32 code_buffer;
+    // zero bits stbi__fill_bits put in past the end of the input. they are
+    // always the top ones, so num_bits < zpad_bits means some got decoded:
+    // the stream was cut short
+    int zpad_bits;
+    stbi__zbits code_buffer;
 
     char *zout;
     char *zout_start;
     char *zout_end;
     int   z_expandable;
 
+#if !defined(STBI_NO_THREADS) && !defined(STBI_NO_PNG)
+    // when streaming to another thread, zout_end is only a soft limit: each
+    // time it's hit, stbi__zexpand publishes the output so far and moves it
+    // on, up to zout_stream_end
+    stbi__progress *progress;
+    char *zout_stream_end;
+#endif
+
     stbi__zhuffman z_length, z_distance;
 } stbi__zbuf;
 
@@ -3873,20 +5699,44 @@ stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
     return *z->zbuffer++;
 }
 
+#ifdef STBI__ZLIB_FAST
+// the bits above num_bits aren't necessarily zero here: they are the
+// next input bits, which every refill ORs in again at the same place.
+static void stbi__fill_bits(stbi__zbuf *z)
+{
+    if (z->zbuffer_end - z->zbuffer >= 8) {
+        // load 8 bytes, keep the whole ones that fit
+        stbi__zbits v;
+        memcpy(&v, z->zbuffer, 8);
+        z->code_buffer |= v << z->num_bits;
+        z->zbuffer += (63 - z->num_bits) >> 3;
+        z->num_bits |= 56;
+    }
+    else {
+        do {
+            if (z->zbuffer >= z->zbuffer_end) z->zpad_bits += 8;
+            z->code_buffer |= (stbi__zbits)stbi__zget8(z) << z->num_bits;
+            z->num_bits += 8;
+        } while (z->num_bits <= 56);
+    }
+}
+#else
 static void stbi__fill_bits(stbi__zbuf *z)
 {
     do {
         STBI_ASSERT(z->code_buffer < (1U << z->num_bits));
+        if (z->zbuffer >= z->zbuffer_end) z->zpad_bits += 8;
         z->code_buffer |= (unsigned int)stbi__zget8(z) << z->num_bits;
         z->num_bits += 8;
     } while (z->num_bits <= 24);
 }
+#endif
 
 stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
 {
     unsigned int k;
     if (z->num_bits < n) stbi__fill_bits(z);
-    k = z->code_buffer & ((1 << n) - 1);
+    k = (unsigned int)(z->code_buffer & ((1 << n) - 1));
     z->code_buffer >>= n;
     z->num_bits -= n;
     return k;
@@ -3897,7 +5747,7 @@ static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
     int b, s, k;
     // not resolved by fast table, so compute it the slow way
     // use jpeg approach, which requires MSbits at top
-    k = stbi__bit_reverse(a->code_buffer, 16);
+    k = stbi__bit_reverse((int)(a->code_buffer & 0xffff), 16);
     for (s = STBI__ZFAST_BITS + 1; ; ++s)
         if (k < z->maxcode[s])
             break;
@@ -3924,17 +5774,28 @@ stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
     return stbi__zhuffman_decode_slowpath(a, z);
 }
 
+#define STBI__ZSTREAM_CHUNK  16384  // how much output to produce between progress updates
+
 static int stbi__zexpand(stbi__zbuf *z, char *zout, int n)  // need to make room for n bytes
 {
     char *q;
     int cur, limit, old_limit;
     z->zout = zout;
+#if !defined(STBI_NO_THREADS) && !defined(STBI_NO_PNG)
+    if (z->progress) {
+        // same message the serial PNG path gives for too much image data
+        if (n > z->zout_stream_end - zout) return stbi__err("not enough pixels", "Corrupt PNG");
+        stbi__progress_set(z->progress, (stbi__uint32)(zout - z->zout_start), 0);
+        z->zout_end = (z->zout_stream_end - zout) - n > STBI__ZSTREAM_CHUNK ? zout + n + STBI__ZSTREAM_CHUNK : z->zout_stream_end;
+        return 1;
+    }
+#endif
     if (!z->z_expandable) return stbi__err("output buffer limit", "Corrupt PNG");
     cur = (int)(z->zout - z->zout_start);
     limit = old_limit = (int)(z->zout_end - z->zout_start);
     while (cur + n > limit)
         limit *= 2;
-    q = (char *)STBI_REALLOC_SIZED(z->zout_start, old_limit, limit);
+    q = (char *)stbi__realloc_sized(z->zout_start, old_limit, limit);
     STBI_NOTUSED(old_limit);
     if (q == NULL) return stbi__err("outofmem", "Out of memory");
     z->zout_start = q;
@@ -3961,20 +5822,41 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
 {
     char *zout = a->zout;
     for (;;) {
-        int z = stbi__zhuffman_decode(a, &a->z_length);
+        int z;
+#ifdef STBI__ZLIB_FAST
+        // 48 bits is enough for a length code, a distance code and both
+        // sets of extra bits, so nothing below has to refill
+        if (a->num_bits < 48) stbi__fill_bits(a);
+#endif
+        z = stbi__zhuffman_decode(a, &a->z_length);
         if (z < 256) {
             if (z < 0) return stbi__err("bad huffman code", "Corrupt PNG"); // error in huffman codes
             if (zout >= a->zout_end) {
+                // past the end of the input the bits read as zeros, which can
+                // be a literal; don't let that grow the output forever
+                if (a->num_bits < a->zpad_bits) return stbi__err("unexpected end", "Corrupt PNG");
                 if (!stbi__zexpand(a, zout, 1)) return 0;
                 zout = a->zout;
             }
             *zout++ = (char)z;
+#ifdef STBI__ZLIB_FAST
+            // literals tend to come in runs; take any that follow straight
+            // from the fast table while the bit buffer has enough bits
+            while (a->num_bits >= STBI__ZFAST_BITS && zout < a->zout_end) {
+                int b = a->z_length.fast[a->code_buffer & STBI__ZFAST_MASK];
+                if (b == 0 || (b & 511) >= 256) break;
+                a->code_buffer >>= b >> 9;
+                a->num_bits -= b >> 9;
+                *zout++ = (char)(b & 511);
+            }
+#endif
         }
         else {
             stbi_uc *p;
             int len, dist;
             if (z == 256) {
                 a->zout = zout;
+                if (a->num_bits < a->zpad_bits) return stbi__err("unexpected end", "Corrupt PNG");
                 return 1;
             }
             z -= 257;
@@ -3986,10 +5868,26 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
             if (stbi__zdist_extra[z]) dist += stbi__zreceive(a, stbi__zdist_extra[z]);
             if (zout - a->zout_start < dist) return stbi__err("bad dist", "Corrupt PNG");
             if (zout + len > a->zout_end) {
+                if (a->num_bits < a->zpad_bits) return stbi__err("unexpected end", "Corrupt PNG");
                 if (!stbi__zexpand(a, zout, len)) return 0;
                 zout = a->zout;
             }
             p = (stbi_uc *)(zout - dist);
+#ifdef STBI__ZLIB_FAST
+            if (dist >= 8 && a->zout_end - zout >= len + 8) {
+                // copy 8 bytes at a time; every chunk read is at least 8
+                // bytes behind, so already written. may write up to 7 bytes
+                // past the match, which the next output overwrites anyway.
+                char *end = zout + len;
+                do {
+                    memcpy(zout, p, 8);
+                    zout += 8;
+                    p += 8;
+                } while (zout < end);
+                zout = end;
+            }
+            else
+#endif
             if (dist == 1) { // run of one byte; common in images.
                 stbi_uc v = *p;
                 if (len) { do *zout++ = v; while (--len); }
@@ -4059,21 +5957,31 @@ static int stbi__parse_uncompressed_block(stbi__zbuf *a)
         stbi__zreceive(a, a->num_bits & 7); // discard
                                             // drain the bit-packed data into header
     k = 0;
-    while (a->num_bits > 0) {
+    while (a->num_bits > 0 && k < 4) {
         header[k++] = (stbi_uc)(a->code_buffer & 255); // suppress MSVC run-time check
         a->code_buffer >>= 8;
         a->num_bits -= 8;
     }
-    STBI_ASSERT(a->num_bits == 0);
+    if (a->num_bits < a->zpad_bits) return stbi__err("unexpected end", "Corrupt PNG");
     // now fill header the normal way
     while (k < 4)
         header[k++] = stbi__zget8(a);
     len = header[1] * 256 + header[0];
     nlen = header[3] * 256 + header[2];
     if (nlen != (len ^ 0xffff)) return stbi__err("zlib corrupt", "Corrupt PNG");
-    if (a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer", "Corrupt PNG");
     if (a->zout + len > a->zout_end)
         if (!stbi__zexpand(a, a->zout, len)) return 0;
+    // a 64-bit bit buffer can hold the first few bytes of the block as well
+    while (a->num_bits > 0 && len > 0) {
+        *a->zout++ = (char)(a->code_buffer & 255);
+        a->code_buffer >>= 8;
+        a->num_bits -= 8;
+        --len;
+    }
+    if (a->num_bits < a->zpad_bits) return stbi__err("unexpected end", "Corrupt PNG");
+    if (a->num_bits == 0)
+        a->code_buffer = 0; // drop the lookahead, reading continues from zbuffer
+    if (a->zbuffer + len > a->zbuffer_end) return stbi__err("read past buffer", "Corrupt PNG");
     memcpy(a->zout, a->zbuffer, len);
     a->zbuffer += len;
     a->zout += len;
@@ -4112,6 +6020,7 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
     if (parse_header)
         if (!stbi__parse_zlib_header(a)) return 0;
     a->num_bits = 0;
+    a->zpad_bits = 0;
     a->code_buffer = 0;
     do {
         final = stbi__zreceive(a, 1);
@@ -4144,6 +6053,9 @@ static int stbi__do_zlib(stbi__zbuf *a, char *obuf, int olen, int exp, int parse
     a->zout = obuf;
     a->zout_end = obuf + olen;
     a->z_expandable = exp;
+#if !defined(STBI_NO_THREADS) && !defined(STBI_NO_PNG)
+    a->progress = NULL;
+#endif
 
     return stbi__parse_zlib(a, parse_header);
 }
@@ -4160,7 +6072,7 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int
         return a.zout_start;
     }
     else {
-        STBI_FREE(a.zout_start);
+        stbi__free(a.zout_start);
         return NULL;
     }
 }
@@ -4182,7 +6094,7 @@ STBIDEF char *stbi_zlib_decode_malloc_guesssize_headerflag(const char *buffer, i
         return a.zout_start;
     }
     else {
-        STBI_FREE(a.zout_start);
+        stbi__free(a.zout_start);
         return NULL;
     }
 }
@@ -4210,7 +6122,7 @@ STBIDEF char *stbi_zlib_decode_noheader_malloc(char const *buffer, int len, int
         return a.zout_start;
     }
     else {
-        STBI_FREE(a.zout_start);
+        stbi__free(a.zout_start);
         return NULL;
     }
 }
@@ -4266,6 +6178,10 @@ typedef struct
     stbi__context *s;
     stbi_uc *idata, *expanded, *out;
     int depth;
+    int into_rows; // 'out' is row 0 from stbi__alloc_rows (8-bit, non-interlaced only)
+#ifndef STBI_NO_THREADS
+    stbi__progress *stream; // if set, 'expanded' is still being inflated on another thread
+#endif
 } stbi__png;
 
 
@@ -4302,6 +6218,132 @@ static int stbi__paeth(int a, int b, int c)
 
 static stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// sse2 unfiltering for 8-bit 3- and 4-channel rows. Sub, Avg and Paeth
+// depend on the pixel to the left, so these work one pixel per register
+// (all channels at once) instead of one byte at a time; Up has no such
+// dependency and does 16 bytes at a time. in_bpp/out_bpp differ when
+// expanding RGB to RGBA, in which case alpha is set to 255.
+//
+// pixels are always loaded and stored as 4 bytes. for 3-byte pixels the
+// extra byte belongs to the next pixel, which gets written afterwards, so
+// only the last pixel of the row needs exact-size accesses; that one is
+// done in plain C.
+stbi_inline static __m128i stbi__png_load_pixel(stbi_uc const *p)
+{
+    int v;
+    memcpy(&v, p, 4);
+    return _mm_cvtsi32_si128(v);
+}
+
+stbi_inline static void stbi__png_store_pixel(stbi_uc *p, __m128i v)
+{
+    int x = _mm_cvtsi128_si32(v);
+    memcpy(p, &x, 4);
+}
+
+// cur, prior and raw point at the second pixel of the row; n >= 1 pixels follow
+static void stbi__png_unfilter_row_simd(stbi_uc *cur, stbi_uc const *prior, stbi_uc const *raw, int n, int filter, int in_bpp, int out_bpp)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i alpha = _mm_cvtsi32_si128(in_bpp != out_bpp ? (int)0xff000000 : 0);
+    __m128i a = stbi__png_load_pixel(cur - out_bpp);
+    int i, k;
+
+    switch (filter) {
+    case STBI__F_sub:
+        for (i = 0; i < n - 1; ++i, cur += out_bpp, raw += in_bpp) {
+            a = _mm_add_epi8(stbi__png_load_pixel(raw), a);
+            a = _mm_or_si128(a, alpha);
+            stbi__png_store_pixel(cur, a);
+        }
+        break;
+    case STBI__F_up:
+        i = 0;
+        if (in_bpp == out_bpp) {
+            // Up doesn't read cur, so redoing the bytes before the next
+            // pixel boundary is harmless
+            for (; i + 16 <= (n - 1) * out_bpp; i += 16) {
+                __m128i x = _mm_loadu_si128((__m128i const *) (raw + i));
+                __m128i b = _mm_loadu_si128((__m128i const *) (prior + i));
+                _mm_storeu_si128((__m128i *) (cur + i), _mm_add_epi8(x, b));
+            }
+            i /= out_bpp;
+            cur += i * out_bpp; prior += i * out_bpp; raw += i * in_bpp;
+        }
+        for (; i < n - 1; ++i, cur += out_bpp, prior += out_bpp, raw += in_bpp) {
+            __m128i b = stbi__png_load_pixel(prior);
+            __m128i x = stbi__png_load_pixel(raw);
+            stbi__png_store_pixel(cur, _mm_or_si128(_mm_add_epi8(x, b), alpha));
+        }
+        break;
+    case STBI__F_avg: {
+        // pavgb rounds up, so subtract the carry to get (a+b)>>1
+        __m128i one = _mm_set1_epi8(1);
+        for (i = 0; i < n - 1; ++i, cur += out_bpp, prior += out_bpp, raw += in_bpp) {
+            __m128i b = stbi__png_load_pixel(prior);
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(stbi__png_load_pixel(raw), avg);
+            a = _mm_or_si128(a, alpha);
+            stbi__png_store_pixel(cur, a);
+        }
+        break;
+    }
+    case STBI__F_paeth: {
+        // same predictor as stbi__paeth, in 16 bits:
+        // pa = |b-c|, pb = |a-c|, pc = |a+b-2c|; ties go to a, then b
+        __m128i c = _mm_unpacklo_epi8(stbi__png_load_pixel(prior - out_bpp), zero);
+        a = _mm_unpacklo_epi8(a, zero);
+        for (i = 0; i < n - 1; ++i, cur += out_bpp, prior += out_bpp, raw += in_bpp) {
+            __m128i b = _mm_unpacklo_epi8(stbi__png_load_pixel(prior), zero);
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a, c);
+            __m128i pc = _mm_add_epi16(pa, pb);
+            __m128i smallest, use_a, use_b, pred, d;
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            use_a = _mm_cmpeq_epi16(pa, smallest);
+            use_b = _mm_andnot_si128(use_a, _mm_cmpeq_epi16(pb, smallest));
+            pred = _mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b));
+            pred = _mm_or_si128(pred, _mm_andnot_si128(_mm_or_si128(use_a, use_b), c));
+            d = _mm_add_epi8(stbi__png_load_pixel(raw), _mm_packus_epi16(pred, pred));
+            d = _mm_or_si128(d, alpha);
+            stbi__png_store_pixel(cur, d);
+            a = _mm_unpacklo_epi8(d, zero);
+            c = b;
+        }
+        break;
+    }
+    }
+
+    // last pixel
+    for (k = 0; k < in_bpp; ++k) {
+        int left = cur[k - out_bpp];
+        switch (filter) {
+        case STBI__F_sub:   cur[k] = STBI__BYTECAST(raw[k] + left); break;
+        case STBI__F_up:    cur[k] = STBI__BYTECAST(raw[k] + prior[k]); break;
+        case STBI__F_avg:   cur[k] = STBI__BYTECAST(raw[k] + ((prior[k] + left) >> 1)); break;
+        case STBI__F_paeth: cur[k] = STBI__BYTECAST(raw[k] + stbi__paeth(left, prior[k], prior[k - out_bpp])); break;
+        }
+    }
+    if (in_bpp != out_bpp)
+        cur[in_bpp] = 255;
+}
+
+// returns 0 if this row isn't handled here
+static int stbi__png_unfilter_simd(stbi_uc *cur, stbi_uc const *prior, stbi_uc const *raw, int n, int filter, int img_n, int out_n)
+{
+    if (filter < STBI__F_sub || filter > STBI__F_paeth || n < 1)
+        return 0;
+    if ((img_n != 3 && img_n != 4) || (out_n != img_n && out_n != 4))
+        return 0;
+    stbi__png_unfilter_row_simd(cur, prior, raw, n, filter, img_n, out_n);
+    return 1;
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4309,16 +6351,26 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
     stbi__context *s = a->s;
     stbi__uint32 i, j, stride = x*out_n*bytes;
     stbi__uint32 img_len, img_width_bytes;
-    int k;
+    int k, out_stride = (int)stride; // between rows of 'out'; negative when flipping into a target
     int img_n = s->img_n; // copy it into a local for later
 
     int output_bytes = out_n*bytes;
     int filter_bytes = img_n*bytes;
     int width = x;
+#ifdef STBI_SSE2
+    int simd = depth == 8 && stbi__sse2_available();
+#endif
 
     STBI_ASSERT(out_n == s->img_n || out_n == s->img_n + 1);
-    a->out = (stbi_uc *)stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
-    if (!a->out) return stbi__err("outofmem", "Out of memory");
+    if (a->into_rows) {
+        STBI_ASSERT(depth == 8);
+        a->out = stbi__alloc_rows(s, x, y, out_n, &out_stride);
+        if (!a->out) return 0;
+    }
+    else {
+        a->out = (stbi_uc *)stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
+        if (!a->out) return stbi__err("outofmem", "Out of memory");
+    }
 
     img_width_bytes = (((img_n * x * depth) + 7) >> 3);
     img_len = (img_width_bytes + 1) * y;
@@ -4330,9 +6382,17 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
     }
 
     for (j = 0; j < y; ++j) {
-        stbi_uc *cur = a->out + stride*j;
-        stbi_uc *prior = cur - stride;
-        int filter = *raw++;
+        stbi_uc *cur = a->out + (ptrdiff_t)out_stride*j;
+        stbi_uc *prior = cur - out_stride;
+        int filter;
+
+#ifndef STBI_NO_THREADS
+        // wait for the inflate thread to get through this row
+        if (a->stream && !stbi__progress_wait(a->stream, (stbi__uint32)(raw - a->expanded) + img_width_bytes + 1))
+            return stbi__err("not enough pixels", "Corrupt PNG");
+#endif
+
+        filter = *raw++;
 
         if (filter > 4)
             return stbi__err("invalid filter", "Corrupt PNG");
@@ -4382,6 +6442,13 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
             prior += 1;
         }
 
+#ifdef STBI_SSE2
+        if (simd && stbi__png_unfilter_simd(cur, prior, raw, x - 1, filter, img_n, out_n)) {
+            raw += (x - 1)*img_n;
+            continue;
+        }
+#endif
+
         // this is a little gross, so that we don't switch per-pixel or per-component
         if (depth < 8 || img_n == out_n) {
             int nk = (width - 1)*filter_bytes;
@@ -4544,7 +6611,7 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint3
         if (x && y) {
             stbi__uint32 img_len = ((((a->s->img_n * x * depth) + 7) >> 3) + 1) * y;
             if (!stbi__create_png_image_raw(a, image_data, image_data_len, out_n, x, y, depth, color)) {
-                STBI_FREE(final);
+                stbi__free(final);
                 return 0;
             }
             for (j = 0; j < y; ++j) {
@@ -4555,7 +6622,7 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint3
                         a->out + (j*x + i)*out_bytes, out_bytes);
                 }
             }
-            STBI_FREE(a->out);
+            stbi__free(a->out);
             image_data += img_len;
             image_data_len -= img_len;
         }
@@ -4565,6 +6632,81 @@ static int stbi__create_png_image(stbi__png *a, stbi_uc *image_data, stbi__uint3
     return 1;
 }
 
+#ifndef STBI_NO_THREADS
+typedef struct
+{
+    stbi__zbuf zbuf;
+    stbi__progress progress;
+    int parse_header;
+    const char *failure_reason;
+} stbi__png_inflate_job;
+
+static int stbi__png_inflate_worker(void *job, int index, int count)
+{
+    stbi__png_inflate_job *j = (stbi__png_inflate_job *)job;
+    int ok = stbi__parse_zlib(&j->zbuf, j->parse_header);
+    if (!ok) j->failure_reason = stbi__g_failure_reason;
+    stbi__progress_set(&j->progress, (stbi__uint32)(j->zbuf.zout - j->zbuf.zout_start), 1);
+    STBI_NOTUSED(index);
+    STBI_NOTUSED(count);
+    return ok;
+}
+
+// inflate on a second thread while this one unfilters the rows that are
+// already there. non-interlaced only, since the output size has to be known
+// up front. returns -1 if the caller should decode serially instead.
+static int stbi__png_decode_pipelined(stbi__png *z, stbi__uint32 idata_len, int parse_header, int out_n, int color)
+{
+    stbi__context *s = z->s;
+    stbi__png_inflate_job job;
+    stbi__worker w;
+    stbi__thread t;
+    int row_bytes, ok;
+
+    if (!stbi__mad3sizes_valid(s->img_n, s->img_x, z->depth, 7)) return -1;
+    row_bytes = ((s->img_n * s->img_x * z->depth + 7) >> 3) + 1;
+    if (!stbi__mad2sizes_valid(row_bytes, s->img_y, 0)) return -1;
+
+    z->expanded = (stbi_uc *)stbi__malloc_mad2(row_bytes, s->img_y, 0);
+    if (!z->expanded) return stbi__err("outofmem", "Out of memory");
+
+    job.zbuf.zbuffer = z->idata;
+    job.zbuf.zbuffer_end = z->idata + idata_len;
+    job.zbuf.zout_start = job.zbuf.zout = (char *)z->expanded;
+    job.zbuf.zout_end = job.zbuf.zout_start; // first output publishes
+    job.zbuf.zout_stream_end = job.zbuf.zout_start + row_bytes * s->img_y;
+    job.zbuf.z_expandable = 0;
+    job.zbuf.progress = &job.progress;
+    job.parse_header = parse_header;
+    job.failure_reason = NULL;
+    stbi__progress_init(&job.progress);
+
+    w.func = stbi__png_inflate_worker;
+    w.job = &job;
+    w.index = 1;
+    w.count = 2;
+    w.result = 0;
+    if (!stbi__thread_start(&t, &w)) {
+        stbi__progress_free(&job.progress);
+        stbi__free(z->expanded); z->expanded = NULL;
+        return -1;
+    }
+
+    z->stream = &job.progress;
+    ok = stbi__create_png_image_raw(z, z->expanded, row_bytes * s->img_y, out_n, s->img_x, s->img_y, z->depth, color);
+    z->stream = NULL;
+
+    // the inflate thread always runs to the end, even if unfiltering failed
+    stbi__thread_join(t);
+    stbi__progress_free(&job.progress);
+    if (!w.result) {
+        stbi__g_failure_reason = job.failure_reason;
+        return 0;
+    }
+    return ok;
+}
+#endif
+
 static int stbi__compute_transparency(stbi__png *z, stbi_uc tc[3], int out_n)
 {
     stbi__context *s = z->s;
@@ -4647,7 +6789,7 @@ static int stbi__expand_png_palette(stbi__png *a, stbi_uc *palette, int len, int
             p += 4;
         }
     }
-    STBI_FREE(a->out);
+    stbi__free(a->out);
     a->out = temp_out;
 
     STBI_NOTUSED(len);
@@ -4655,7 +6797,6 @@ static int stbi__expand_png_palette(stbi__png *a, stbi_uc *palette, int len, int
     return 1;
 }
 
-static int stbi__unpremultiply_on_load = 0;
 static int stbi__de_iphone_flag = 0;
 
 STBIDEF void stbi_set_unpremultiply_on_load(int flag_true_if_should_unpremultiply)
@@ -4684,7 +6825,7 @@ static void stbi__de_iphone(stbi__png *z)
     }
     else {
         STBI_ASSERT(s->img_out_n == 4);
-        if (stbi__unpremultiply_on_load) {
+        if (s->unpremultiply) {
             // convert bgr to rgb and unpremultiply
             for (i = 0; i < pixel_count; ++i) {
                 stbi_uc a = p[3];
@@ -4727,6 +6868,10 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
     z->expanded = NULL;
     z->idata = NULL;
     z->out = NULL;
+    z->into_rows = 0;
+#ifndef STBI_NO_THREADS
+    z->stream = NULL;
+#endif
 
     if (!stbi__check_png_header(s)) return 0;
 
@@ -4820,7 +6965,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
                 while (ioff + c.length > idata_limit)
                     idata_limit *= 2;
                 STBI_NOTUSED(idata_limit_old);
-                p = (stbi_uc *)STBI_REALLOC_SIZED(z->idata, idata_limit_old, idata_limit); if (p == NULL) return stbi__err("outofmem", "Out of memory");
+                p = (stbi_uc *)stbi__realloc_sized(z->idata, idata_limit_old, idata_limit); if (p == NULL) return stbi__err("outofmem", "Out of memory");
                 z->idata = p;
             }
             if (!stbi__getn(s, z->idata + ioff, c.length)) return stbi__err("outofdata", "Corrupt PNG");
@@ -4830,20 +6975,36 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
 
         case STBI__PNG_TYPE('I', 'E', 'N', 'D'): {
             stbi__uint32 raw_len, bpl;
+            int pipelined;
             if (first) return stbi__err("first not IHDR", "Corrupt PNG");
             if (scan != STBI__SCAN_load) return 1;
             if (z->idata == NULL) return stbi__err("no IDAT", "Corrupt PNG");
-            // initial guess for decoded data size to avoid unnecessary reallocs
-            bpl = (s->img_x * z->depth + 7) / 8; // bytes per line, per component
-            raw_len = bpl * s->img_y * s->img_n /* pixels */ + s->img_y /* filter mode per row */;
-            z->expanded = (stbi_uc *)stbi_zlib_decode_malloc_guesssize_headerflag((char *)z->idata, ioff, raw_len, (int *)&raw_len, !is_iphone);
-            if (z->expanded == NULL) return 0; // zlib should set error
-            STBI_FREE(z->idata); z->idata = NULL;
             if ((req_comp == s->img_n + 1 && req_comp != 3 && !pal_img_n) || has_trans)
                 s->img_out_n = s->img_n + 1;
             else
                 s->img_out_n = s->img_n;
-            if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
+            // plain 8-bit images that need no conversion afterwards are
+            // unfiltered straight into their final rows (flipped, or in the
+            // caller's target)
+            z->into_rows = z->depth == 8 && !interlace && !has_trans && !is_iphone && !pal_img_n &&
+                (req_comp == 0 || req_comp == s->img_out_n);
+            pipelined = -1;
+#ifndef STBI_NO_THREADS
+            if (s->num_threads > 1 && !interlace) {
+                pipelined = stbi__png_decode_pipelined(z, ioff, !is_iphone, s->img_out_n, color);
+                if (!pipelined) return 0;
+                stbi__free(z->idata); z->idata = NULL;
+            }
+#endif
+            if (pipelined < 0) {
+                // initial guess for decoded data size to avoid unnecessary reallocs
+                bpl = (s->img_x * z->depth + 7) / 8; // bytes per line, per component
+                raw_len = bpl * s->img_y * s->img_n /* pixels */ + s->img_y /* filter mode per row */;
+                z->expanded = (stbi_uc *)stbi_zlib_decode_malloc_guesssize_headerflag((char *)z->idata, ioff, raw_len, (int *)&raw_len, !is_iphone);
+                if (z->expanded == NULL) return 0; // zlib should set error
+                stbi__free(z->idata); z->idata = NULL;
+                if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
+            }
             if (has_trans) {
                 if (z->depth == 16) {
                     if (!stbi__compute_transparency16(z, tc16, s->img_out_n)) return 0;
@@ -4862,7 +7023,7 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
                 if (!stbi__expand_png_palette(z, palette, pal_len, s->img_out_n))
                     return 0;
             }
-            STBI_FREE(z->expanded); z->expanded = NULL;
+            stbi__free(z->expanded); z->expanded = NULL;
             return 1;
         }
 
@@ -4911,9 +7072,13 @@ static void *stbi__do_png(stbi__png *p, int *x, int *y, int *n, int req_comp, st
         *y = p->s->img_y;
         if (n) *n = p->s->img_n;
     }
-    STBI_FREE(p->out);      p->out = NULL;
-    STBI_FREE(p->expanded); p->expanded = NULL;
-    STBI_FREE(p->idata);    p->idata = NULL;
+    if (p->into_rows) {
+        if (!result) stbi__free_rows(p->s);
+        p->out = NULL;
+    }
+    stbi__free(p->out);      p->out = NULL;
+    stbi__free(p->expanded); p->expanded = NULL;
+    stbi__free(p->idata);    p->idata = NULL;
 
     return result;
 }
@@ -5161,7 +7326,7 @@ static void *stbi__bmp_load(stbi__context *s, int *x, int *y, int *comp, int req
     if (!out) return stbi__errpuc("outofmem", "Out of memory");
     if (info.bpp < 16) {
         int z = 0;
-        if (psize == 0 || psize > 256) { STBI_FREE(out); return stbi__errpuc("invalid", "Corrupt BMP"); }
+        if (psize == 0 || psize > 256) { stbi__free(out); return stbi__errpuc("invalid", "Corrupt BMP"); }
         for (i = 0; i < psize; ++i) {
             pal[i][2] = stbi__get8(s);
             pal[i][1] = stbi__get8(s);
@@ -5172,7 +7337,7 @@ static void *stbi__bmp_load(stbi__context *s, int *x, int *y, int *comp, int req
         stbi__skip(s, info.offset - 14 - info.hsz - psize * (info.hsz == 12 ? 3 : 4));
         if (info.bpp == 4) width = (s->img_x + 1) >> 1;
         else if (info.bpp == 8) width = s->img_x;
-        else { STBI_FREE(out); return stbi__errpuc("bad bpp", "Corrupt BMP"); }
+        else { stbi__free(out); return stbi__errpuc("bad bpp", "Corrupt BMP"); }
         pad = (-width) & 3;
         for (j = 0; j < (int)s->img_y; ++j) {
             for (i = 0; i < (int)s->img_x; i += 2) {
@@ -5212,7 +7377,7 @@ static void *stbi__bmp_load(stbi__context *s, int *x, int *y, int *comp, int req
                 easy = 2;
         }
         if (!easy) {
-            if (!mr || !mg || !mb) { STBI_FREE(out); return stbi__errpuc("bad masks", "Corrupt BMP"); }
+            if (!mr || !mg || !mb) { stbi__free(out); return stbi__errpuc("bad masks", "Corrupt BMP"); }
             // right shift amt to put high bit in position #7
             rshift = stbi__high_bit(mr) - 7; rcount = stbi__bitcount(mr);
             gshift = stbi__high_bit(mg) - 7; gcount = stbi__bitcount(mg);
@@ -5489,7 +7654,7 @@ static void *stbi__tga_load(stbi__context *s, int *x, int *y, int *comp, int req
             //   load the palette
             tga_palette = (unsigned char*)stbi__malloc_mad2(tga_palette_len, tga_comp, 0);
             if (!tga_palette) {
-                STBI_FREE(tga_data);
+                stbi__free(tga_data);
                 return stbi__errpuc("outofmem", "Out of memory");
             }
             if (tga_rgb16) {
@@ -5501,8 +7666,8 @@ static void *stbi__tga_load(stbi__context *s, int *x, int *y, int *comp, int req
                 }
             }
             else if (!stbi__getn(s, tga_palette, tga_palette_len * tga_comp)) {
-                STBI_FREE(tga_data);
-                STBI_FREE(tga_palette);
+                stbi__free(tga_data);
+                stbi__free(tga_palette);
                 return stbi__errpuc("bad palette", "Corrupt TGA");
             }
         }
@@ -5587,7 +7752,7 @@ static void *stbi__tga_load(stbi__context *s, int *x, int *y, int *comp, int req
         //   clear my palette, if I had one
         if (tga_palette != NULL)
         {
-            STBI_FREE(tga_palette);
+            stbi__free(tga_palette);
         }
     }
 
@@ -5779,7 +7944,7 @@ static void *stbi__psd_load(stbi__context *s, int *x, int *y, int *comp, int req
             else {
                 // Read the RLE data.
                 if (!stbi__psd_decode_rle(s, p, pixelCount)) {
-                    STBI_FREE(out);
+                    stbi__free(out);
                     return stbi__errpuc("corrupt", "bad RLE data");
                 }
             }
@@ -6071,7 +8236,7 @@ static void *stbi__pic_load(stbi__context *s, int *px, int *py, int *comp, int r
     memset(result, 0xff, x*y * 4);
 
     if (!stbi__pic_load_core(s, x, y, comp, result)) {
-        STBI_FREE(result);
+        stbi__free(result);
         result = 0;
     }
     *px = x;
@@ -6177,14 +8342,15 @@ static int stbi__gif_header(stbi__context *s, stbi__gif *g, int *comp, int is_in
 static int stbi__gif_info_raw(stbi__context *s, int *x, int *y, int *comp)
 {
     stbi__gif* g = (stbi__gif*)stbi__malloc(sizeof(stbi__gif));
+    if (!g) return stbi__err("outofmem", "Out of memory");
     if (!stbi__gif_header(s, g, comp, 1)) {
-        STBI_FREE(g);
+        stbi__free(g);
         stbi__rewind(s);
         return 0;
     }
     if (x) *x = g->w;
     if (y) *y = g->h;
-    STBI_FREE(g);
+    stbi__free(g);
     return 1;
 }
 
@@ -6450,6 +8616,7 @@ static void *stbi__gif_load(stbi__context *s, int *x, int *y, int *comp, int req
 {
     stbi_uc *u = 0;
     stbi__gif* g = (stbi__gif*)stbi__malloc(sizeof(stbi__gif));
+    if (!g) return stbi__errpuc("outofmem", "Out of memory");
     memset(g, 0, sizeof(*g));
     STBI_NOTUSED(ri);
 
@@ -6462,8 +8629,8 @@ static void *stbi__gif_load(stbi__context *s, int *x, int *y, int *comp, int req
             u = stbi__convert_format(u, 4, req_comp, g->w, g->h);
     }
     else if (g->out)
-        STBI_FREE(g->out);
-    STBI_FREE(g);
+        stbi__free(g->out);
+    stbi__free(g);
     return u;
 }
 
@@ -6634,16 +8801,16 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
                 stbi__hdr_convert(hdr_data, rgbe, req_comp);
                 i = 1;
                 j = 0;
-                STBI_FREE(scanline);
+                stbi__free(scanline);
                 goto main_decode_loop; // yes, this makes no sense
             }
             len <<= 8;
             len |= stbi__get8(s);
-            if (len != width) { STBI_FREE(hdr_data); STBI_FREE(scanline); return stbi__errpf("invalid decoded scanline length", "corrupt HDR"); }
+            if (len != width) { stbi__free(hdr_data); stbi__free(scanline); return stbi__errpf("invalid decoded scanline length", "corrupt HDR"); }
             if (scanline == NULL) {
                 scanline = (stbi_uc *)stbi__malloc_mad2(width, 4, 0);
                 if (!scanline) {
-                    STBI_FREE(hdr_data);
+                    stbi__free(hdr_data);
                     return stbi__errpf("outofmem", "Out of memory");
                 }
             }
@@ -6657,13 +8824,13 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
                         // Run
                         value = stbi__get8(s);
                         count -= 128;
-                        if (count > nleft) { STBI_FREE(hdr_data); STBI_FREE(scanline); return stbi__errpf("corrupt", "bad RLE data in HDR"); }
+                        if (count > nleft) { stbi__free(hdr_data); stbi__free(scanline); return stbi__errpf("corrupt", "bad RLE data in HDR"); }
                         for (z = 0; z < count; ++z)
                             scanline[i++ * 4 + k] = value;
                     }
                     else {
                         // Dump
-                        if (count > nleft) { STBI_FREE(hdr_data); STBI_FREE(scanline); return stbi__errpf("corrupt", "bad RLE data in HDR"); }
+                        if (count > nleft) { stbi__free(hdr_data); stbi__free(scanline); return stbi__errpf("corrupt", "bad RLE data in HDR"); }
                         for (z = 0; z < count; ++z)
                             scanline[i++ * 4 + k] = stbi__get8(s);
                     }
@@ -6673,7 +8840,7 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
                 stbi__hdr_convert(hdr_data + (j*width + i)*req_comp, scanline + i * 4, req_comp);
         }
         if (scanline)
-            STBI_FREE(scanline);
+            stbi__free(scanline);
     }
 
     return hdr_data;
@@ -7027,6 +9194,29 @@ STBIDEF int stbi_info_from_callbacks(stbi_io_callbacks const *c, void *user, int
     return stbi__info_main(&s, x, y, comp);
 }
 
+STBIDEF int stbi_info_from_memory_ex(stbi_uc const *buffer, int len, int *x, int *y, int *comp, stbi_load_options const *options)
+{
+    stbi__context s;
+    stbi__start_mem(&s, buffer, len);
+    if (options && !stbi__apply_options(&s, options)) return 0;
+    return stbi__info_main(&s, x, y, comp);
+}
+
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_info_ex(char const *filename, int *x, int *y, int *comp, stbi_load_options const *options)
+{
+    FILE *f = stbi__fopen(filename, "rb");
+    stbi__context s;
+    int result = 0;
+    if (!f) return stbi__err("can't fopen", "Unable to open file");
+    stbi__start_file(&s, f);
+    if (!options || stbi__apply_options(&s, options))
+        result = stbi__info_main(&s, x, y, comp);
+    fclose(f);
+    return result;
+}
+#endif
+
 #endif // STB_IMAGE_IMPLEMENTATION
 
 /*
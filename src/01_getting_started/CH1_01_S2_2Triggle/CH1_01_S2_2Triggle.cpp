@@ -3,6 +3,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
+#include <memory>
+
+#include <learnopengl/shader_s.h>
+#include <learnopengl/shader_pipeline.h>
 // GLAD是用来管理OpenGL的函数指针
 
 // eg1: 使用不同的VAO  VBO 创建的2个三角形
@@ -69,70 +73,28 @@ int main()
     glViewport(0, 0, 800, 600);
 
     // build and compile our shader program
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    unsigned int fragmentShaderGreen = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glShaderSource(fragmentShaderGreen, 1, &fragmentShaderSourceGreen, NULL);
-
-    glCompileShader(vertexShader);
-    glCompileShader(fragmentShader);
-    glCompileShader(fragmentShaderGreen);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        std::cout << "compile vertex fail" << infoLog << std::endl;
-    }
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    // 两个程序的顶点着色器是同一个：支持 separable program 时只编译一次顶点着色器，
+    // 再和两个片元着色器各组成一个 pipeline，不用为每种组合重新链接。
+    // 不支持时 (macOS) 才链接两个完整的程序；源码就是上面的字符串，编译、链接和错误检查交给 Shader
+    ShaderPipelines pipelines;
+    Shader *vertexStage = nullptr, *orangeStage = nullptr, *greenStage = nullptr;
+    std::unique_ptr<Shader> ourShader, ourShaderGreen;
+    if (ShaderPipelines::supported())
     {
-        std::cout << "compile fragment fail" << infoLog << std::endl;
+        vertexStage = &pipelines.stage(GL_VERTEX_SHADER, vertexShaderSource);
+        orangeStage = &pipelines.stage(GL_FRAGMENT_SHADER, fragmentShaderSource);
+        greenStage = &pipelines.stage(GL_FRAGMENT_SHADER, fragmentShaderSourceGreen);
     }
-
-    glGetShaderiv(fragmentShaderGreen, GL_COMPILE_STATUS, &success);
-    if (!success)
+    else
     {
-        std::cout << "compile fragment green fail" << infoLog << std::endl;
-    }
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    unsigned int shaderProgramGreen = glCreateProgram();
-    glAttachShader(shaderProgramGreen, vertexShader);
-    glAttachShader(shaderProgramGreen, fragmentShaderGreen);
-    glLinkProgram(shaderProgramGreen);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "link shader fail" << infoLog << std::endl;
-    }
-
-    glGetProgramiv(shaderProgramGreen, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgramGreen, 512, NULL, infoLog);
-        std::cout << "link shader green fail" << infoLog << std::endl;
+        ourShader.reset(new Shader(Shader::fromSource(vertexShaderSource, fragmentShaderSource)));
+        ourShaderGreen.reset(new Shader(Shader::fromSource(vertexShaderSource, fragmentShaderSourceGreen)));
     }
 
     // int nrAttributes;
     // glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
     // std::cout << "Maximum nr of vertex attributes supported: " << nrAttributes << std::endl;
 
-    // 编译完成后删除Shader
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(fragmentShaderGreen);
-
     // VAO 中包含很多 VBO ,一个VBO 中有「position,color,uv 等信息构成」
     // 使用glDrawArry 绘制2个三角形 练习题1
     float vertices1[] = {
@@ -178,12 +140,18 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
+        if (vertexStage)
+            pipelines.bind(*vertexStage, *orangeStage);
+        else
+            ourShader->use();
 
         glBindVertexArray(VAO[0]);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        glUseProgram(shaderProgramGreen);
+        if (vertexStage)
+            pipelines.bind(*vertexStage, *greenStage);
+        else
+            ourShaderGreen->use();
         glBindVertexArray(VAO[1]);
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
@@ -198,8 +166,12 @@ int main()
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(2, VAO);
     glDeleteBuffers(2, VBO);
-    glDeleteProgram(shaderProgram);
-    glDeleteProgram(shaderProgramGreen);
+    if (ourShader)
+    {
+        glDeleteProgram(ourShader->ID);
+        glDeleteProgram(ourShaderGreen->ID);
+    }
+    pipelines.clear();
 
     // 渲染循环结束后我们需要正确释放/删除之前的分配的所有资源
     glfwTerminate();
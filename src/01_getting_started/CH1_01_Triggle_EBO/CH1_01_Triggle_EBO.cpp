@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <iostream>
 
+#include <learnopengl/shader_s.h>
+
 // GLAD是用来管理OpenGL的函数指针
 
 // VAO vertex array object
@@ -64,43 +66,8 @@ int main()
     glViewport(0, 0, 800, 600);
 
     // build and compile our shader program
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-
-    glCompileShader(vertexShader);
-    glCompileShader(fragmentShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        std::cout << "compile vertex fail" << infoLog << std::endl;
-    }
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        std::cout << "compile fragment fail" << infoLog << std::endl;
-    }
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "link shader fail" << infoLog << std::endl;
-    }
-
-    // 编译完成后删除Shader
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // 源码就是上面的字符串，不用读文件；编译、链接和错误检查交给 Shader
+    Shader ourShader = Shader::fromSource(vertexShaderSource, fragmentShaderSource);
 
     // VAO 中包含很多 VBO ,一个VBO 中有「position,color,uv 等信息构成」
     float vertices[] = {
@@ -156,7 +123,7 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
+        ourShader.use();
 
         // glBindVertexArray(VAO);
         // glDrawArrays(GL_TRIANGLES, 0, 3);
@@ -176,7 +143,7 @@ int main()
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteProgram(ourShader.ID);
 
     // 渲染循环结束后我们需要正确释放/删除之前的分配的所有资源
     glfwTerminate();
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <iostream>
 
+#include <learnopengl/shader_s.h>
+
 // GLAD是用来管理OpenGL的函数指针
 
 // VAO vertex array object
@@ -69,43 +71,8 @@ int main()
     glViewport(0, 0, 800, 600);
 
     // build and compile our shader program
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-
-    glCompileShader(vertexShader);
-    glCompileShader(fragmentShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        std::cout << "compile vertex fail" << infoLog << std::endl;
-    }
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        std::cout << "compile fragment fail" << infoLog << std::endl;
-    }
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "link shader fail" << infoLog << std::endl;
-    }
-
-    // 编译完成后删除Shader
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // 源码就是上面的字符串，不用读文件；编译、链接和错误检查交给 Shader
+    Shader ourShader = Shader::fromSource(vertexShaderSource, fragmentShaderSource);
 
     // VAO 中包含很多 VBO ,一个VBO 中有「position,color,uv 等信息构成」
     // float vertices[] = {
@@ -152,9 +119,9 @@ int main()
 
         float timeValue = glfwGetTime();
         float greenValue = sin(timeValue) / 2 + 0.5;
-        int vertexOutColorLocation = glGetUniformLocation(shaderProgram, "OutColor");
-        glUseProgram(shaderProgram);
-        glUniform4f(vertexOutColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
+        float outColor[] = {0.0f, greenValue, 0.0f, 1.0f};
+        ourShader.use();
+        ourShader.setVec4("OutColor", outColor);
 
         glBindVertexArray(VAO);
 
@@ -171,7 +138,7 @@ int main()
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteProgram(ourShader.ID);
 
     // 渲染循环结束后我们需要正确释放/删除之前的分配的所有资源
     glfwTerminate();
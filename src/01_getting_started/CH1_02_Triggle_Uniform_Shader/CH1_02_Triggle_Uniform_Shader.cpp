@@ -5,6 +5,7 @@
 #include <iostream>
 
 #include <learnopengl/shader_s.h>
+#include <learnopengl/shader_archive.h>
 #include <learnopengl/filesystem.h>
 
 void frame_buffer_size_callback(GLFWwindow *window, int width, int height);
@@ -49,7 +50,13 @@ int main()
     // OpenGL渲染窗口的尺寸大小，即视口(Viewport)
     glViewport(0, 0, 800, 600);
 
-    Shader ourShader(FileSystem::getPath("resources/shader/3_3_shader.vs").c_str(), FileSystem::getPath("resources/shader/3_3_shader.fs").c_str());
+    // 链接好的 program 二进制缓存在 bin/shader_cache，第二次启动直接加载，不再编译
+    ProgramCache::setDirectory(FileSystem::getPath("bin/shader_cache"));
+    // 所有着色器都打包在 bin/shaders.glsa 里 (cmake 时生成)，启动只读这一个文件
+    ShaderArchive shaders(FileSystem::getPath("bin/shaders.glsa"));
+    Shader ourShader = shaders.shader("3_3_shader.vs", "3_3_shader.fs");
+    std::cout << "shader: " << (ourShader.buildInfo.cacheHit ? "cache hit" : "cache miss") << ", "
+              << ourShader.buildInfo.milliseconds << " ms" << std::endl;
 
     float vertices[] = {
         // 位置              // 颜色
@@ -3,9 +3,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
-#include <stb_image.h>
 
 #include <learnopengl/shader_s.h>
+#include <learnopengl/shader_archive.h>
+#include <learnopengl/shader_watcher.h>
+#include <learnopengl/render_state.h>
+#include <learnopengl/texture_streamer.h>
 #include <learnopengl/filesystem.h>
 
 void frame_buffer_size_callback(GLFWwindow *window, int width, int height);
@@ -52,13 +55,22 @@ int main()
     // OpenGL渲染窗口的尺寸大小，即视口(Viewport)
     glViewport(0, 0, 800, 600);
 
-    Shader ourShader(FileSystem::getPath("resources/shader/3_4_tex2D.vs").c_str(), FileSystem::getPath("resources/shader/3_4_tex2D.fs").c_str()); // you can name your shader files however you like
+    // 链接好的 program 二进制缓存在 bin/shader_cache，第二次启动直接加载，不再编译
+    ProgramCache::setDirectory(FileSystem::getPath("bin/shader_cache"));
+    std::string vertexPath = FileSystem::getPath("resources/shader/3_4_tex2D.vs");
+    std::string fragmentPath = FileSystem::getPath("resources/shader/3_4_tex2D.fs");
+    // 所有着色器都打包在 bin/shaders.glsa 里 (cmake 时生成)，启动只读这一个文件
+    ShaderArchive shaders(FileSystem::getPath("bin/shaders.glsa"));
+    Shader ourShader = shaders.shader("3_4_tex2D.vs", "3_4_tex2D.fs");
+    std::cout << "shader: " << (ourShader.buildInfo.cacheHit ? "cache hit" : "cache miss") << ", "
+              << ourShader.buildInfo.milliseconds << " ms" << std::endl;
 
     // 创建贴图
-    unsigned int texture, texture2;
-    int width, height, nrChannels;
-
-    glGenTextures(1, &texture);
+    // 图片在 TextureStreamer 的工作线程里直接解码进映射好的 PBO (解码时上下翻转)，渲染循环里
+    // 每帧最多从 PBO 上传 4 MB 到贴图；加载完之前贴图是黑的，大图也不会让某一帧卡住。
+    // 两张贴图的缩小过滤都是 GL_LINEAR，用不到 mipmap，所以不生成
+    TextureStreamer textureStreamer(4.0);
+    unsigned int texture = textureStreamer.load(FileSystem::getPath("resources/textures/awesomeface.png"), 4, false);
     glBindTexture(GL_TEXTURE_2D, texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -70,24 +82,7 @@ int main()
     // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    stbi_set_flip_vertically_on_load(true);
-
-    unsigned char *data = stbi_load(FileSystem::getPath("resources/textures/awesomeface.png").c_str(), &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        // glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // std::cout << "width " << width << "height " << height << std::endl;
-    }
-    else
-    {
-        std::cout << "failed to load texture" << std::endl;
-    }
-    stbi_image_free(data);
-
-    glGenTextures(1, &texture2);
+    unsigned int texture2 = textureStreamer.load(FileSystem::getPath("resources/textures/container.jpg"), 3, false);
     glBindTexture(GL_TEXTURE_2D, texture2);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -95,21 +90,6 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    data = stbi_load(FileSystem::getPath("resources/textures/container.jpg").c_str(), &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        // glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // std::cout << "width " << width << "height " << height << std::endl;
-    }
-    else
-    {
-        std::cout << "failed to load texture" << std::endl;
-    }
-    stbi_image_free(data);
-
     float vertices[] = {
         //     ---- 位置 ----       ---- 颜色 ----     - 纹理坐标 -
         0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,   // 右上
@@ -170,28 +150,40 @@ int main()
     // glUniform1i(glGetUniformLocation(ourShader.ID, "_MainTex"), 0);
     ourShader.setInt("_MainTex", 0);
     ourShader.setInt("_MainTex2", 1);
+    // 每帧都要设置的 uniform 先取句柄，循环里就不用再按名字查找；值没变时也不会重复上传
+    UniformHandle mixValueLoc = ourShader.uniform("_mixValue");
+
+    // 运行时修改并保存 3_4_tex2D.vs/.fs 会自动重新编译；编译失败时继续用旧的 program
+    ShaderWatcher shaderWatcher;
+    // 开始时的源码直接用包里的，不再读一遍文件
+    shaderWatcher.watch(ourShader, vertexPath.c_str(), fragmentPath.c_str(), shaders.source("3_4_tex2D.vs"), shaders.source("3_4_tex2D.fs"));
 
     // glUniform1i(glGetUniformLocation(ourShader.ID, "_MainTex"), 0);
 
+    // 循环里的绑定都经过 RenderState：和上一帧一样的绑定不会再调用 GL
+    RenderState state;
+
     // 函数在我们每次循环的开始前检查一次GLFW是否被要求退出
     while (!glfwWindowShouldClose(window))
     {
         // 输入
         processInput(window);
+        // 没有文件改动时只是读一个原子变量
+        shaderWatcher.update();
+        // 把解码好的图片在预算内传给贴图
+        textureStreamer.update();
 
         // 执行渲染 。。。
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
-        ourShader.setFloat("_mixValue", mixValue);
-        ourShader.use();
+        state.bindTexture(0, GL_TEXTURE_2D, texture);
+        state.bindTexture(1, GL_TEXTURE_2D, texture2);
+        // 热重载后 ourShader.ID 会变，那时才真正调用 glUseProgram
+        state.useProgram(ourShader.ID);
+        ourShader.setFloat(mixValueLoc, mixValue);
 
-        glBindVertexArray(VAO);
+        state.bindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
         // 检查并调用事件，交换缓冲
@@ -203,8 +195,17 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
+    std::cout << "state changes: " << state.issued() << " issued, " << state.filtered() << " filtered" << std::endl;
+    for (unsigned int t : {texture, texture2})
+    {
+        if (textureStreamer.ready(t))
+            std::cout << "texture " << t << ": " << textureStreamer.loadMilliseconds(t) << " ms over "
+                      << textureStreamer.loadFrames(t) << " frames" << std::endl;
+    }
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    shaderWatcher.clear();
+    textureStreamer.clear();
 
     // 渲染循环结束后我们需要正确释放/删除之前的分配的所有资源
     glfwTerminate();
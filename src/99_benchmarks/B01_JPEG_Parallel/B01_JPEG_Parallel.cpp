@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+
+// 用法: B01_JPEG_Parallel [图片路径] [最大线程数] [重复次数]
+// 大图最好带 restart marker (例如 cjpeg -restart 1)，否则只有上采样/颜色转换是并行的
+
+typedef unsigned char *(*LoadFunc)(const char *path, int *x, int *y, int *n, int threads);
+
+static unsigned char *loadSerial(const char *path, int *x, int *y, int *n, int /* threads */)
+{
+    return stbi_load(path, x, y, n, 4);
+}
+
+static unsigned char *loadParallel(const char *path, int *x, int *y, int *n, int threads)
+{
+    return stbi_load_parallel(path, x, y, n, 4, threads);
+}
+
+// 返回解码后的 MB/s
+double measure(LoadFunc load, const char *path, int threads, int iterations)
+{
+    int width = 0, height = 0, nrChannels = 0;
+    double bytes = 0.0;
+
+    // 先预热一次，把文件读进 page cache
+    stbi_image_free(load(path, &width, &height, &nrChannels, threads));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        unsigned char *data = load(path, &width, &height, &nrChannels, threads);
+        if (!data)
+        {
+            std::cout << "failed to load " << path << ": " << stbi_failure_reason() << std::endl;
+            return 0.0;
+        }
+        bytes += (double)width * height * 4;
+        stbi_image_free(data);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return bytes / (1024.0 * 1024.0) / seconds;
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : FileSystem::getPath("resources/textures/container.jpg");
+    int maxThreads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    int width, height, nrChannels;
+    if (!stbi_info(path.c_str(), &width, &height, &nrChannels))
+    {
+        std::cout << "failed to read " << path << std::endl;
+        return -1;
+    }
+    std::cout << path << " " << width << "x" << height << "x" << nrChannels << std::endl;
+
+    double serial = measure(loadSerial, path.c_str(), 1, iterations);
+    printf("stbi_load                  %8.1f MB/s\n", serial);
+    for (int threads = 1; threads <= maxThreads; ++threads)
+    {
+        double parallel = measure(loadParallel, path.c_str(), threads, iterations);
+        printf("stbi_load_parallel %2d cores %8.1f MB/s  (x%.2f)\n", threads, parallel, parallel / serial);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// 直接测内部 kernel，所以这里单独编译一份 static 的实现；
+// 这里只用到其中几个函数，其余 static 函数没用到是正常的，不报警告
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include <stb_image.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+// 用法: B02_JPEG_SIMD [重复次数]
+// 分别测 IDCT、YCbCr->RGB、2x2 上采样的 SSE2 / AVX2 版本，并检查两者输出是否完全一致
+
+#if defined(STBI_SSE2) && defined(STBI_AVX2)
+
+typedef void (*IdctFunc)(stbi_uc *out, int out_stride, short data[64]);
+typedef void (*ColorFunc)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
+typedef stbi_uc *(*ResampleFunc)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
+
+const int BLOCKS = 1024;
+const int ROW = 1920;
+
+static STBI_SIMD_ALIGN(short, coeffs[BLOCKS][64]);
+static stbi_uc idctOut[2][BLOCKS * 64];
+static stbi_uc planes[3][ROW + 16];
+static stbi_uc rowOut[2][ROW * 4 + 64];
+
+// 返回每次调用的纳秒数
+template <typename F>
+double timeIt(F f, int iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+static void report(const char *name, double sse2, double avx2, bool same)
+{
+    printf("%-12s SSE2 %9.1f ns  AVX2 %9.1f ns  (x%.2f)  %s\n", name, sse2, avx2, sse2 / avx2, same ? "bit-exact" : "MISMATCH");
+}
+
+static void runIdct(IdctFunc idct, stbi_uc *out)
+{
+    STBI_SIMD_ALIGN(short, data[64]);
+    for (int b = 0; b < BLOCKS; ++b)
+    {
+        // kernel 会改写系数，所以每次都从备份拷贝
+        memcpy(data, coeffs[b], sizeof(data));
+        idct(out + b * 8, BLOCKS * 8, data);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    if (!stbi__avx2_available())
+    {
+        printf("this CPU has no AVX2\n");
+        return 0;
+    }
+
+    // 模拟反量化后的系数: DC 大，高频系数小且大多为 0
+    srand(1);
+    for (int b = 0; b < BLOCKS; ++b)
+        for (int k = 0; k < 64; ++k)
+            coeffs[b][k] = k == 0 ? (short)(rand() % 2048 - 1024) : (rand() % 4 ? 0 : (short)(rand() % 512 - 256));
+    for (int c = 0; c < 3; ++c)
+        for (int i = 0; i < ROW + 16; ++i)
+            planes[c][i] = (stbi_uc)rand();
+
+    double sse2 = timeIt([&] { runIdct(stbi__idct_simd, idctOut[0]); }, iterations) / BLOCKS;
+    double avx2 = timeIt([&] { runIdct(stbi__idct_avx2, idctOut[1]); }, iterations) / BLOCKS;
+    report("idct 8x8", sse2, avx2, memcmp(idctOut[0], idctOut[1], sizeof(idctOut[0])) == 0);
+
+    sse2 = timeIt([&] { stbi__YCbCr_to_RGB_simd(rowOut[0], planes[0], planes[1], planes[2], ROW, 4); }, iterations);
+    avx2 = timeIt([&] { stbi__YCbCr_to_RGB_avx2(rowOut[1], planes[0], planes[1], planes[2], ROW, 4); }, iterations);
+    report("ycbcr->rgba", sse2, avx2, memcmp(rowOut[0], rowOut[1], ROW * 4) == 0);
+
+    // 输入宽度是输出的一半
+    sse2 = timeIt([&] { stbi__resample_row_hv_2_simd(rowOut[0], planes[0], planes[1], ROW / 2, 2); }, iterations);
+    avx2 = timeIt([&] { stbi__resample_row_hv_2_avx2(rowOut[1], planes[0], planes[1], ROW / 2, 2); }, iterations);
+    report("h2v2 row", sse2, avx2, memcmp(rowOut[0], rowOut[1], ROW) == 0);
+    return 0;
+}
+
+#else
+
+int main()
+{
+    printf("stb_image was built without SSE2/AVX2 kernels\n");
+    return 0;
+}
+
+#endif
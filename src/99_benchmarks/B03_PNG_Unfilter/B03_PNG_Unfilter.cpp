@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <stb_image.h>
+
+// 用法: B03_PNG_Unfilter [边长] [重复次数]
+// 生成 RGB / RGBA 的合成 PNG，每张图所有行都用同一种 filter，
+// 分别测 stbi_load_from_memory 和 stbi_load_from_memory_parallel (inflate 与反滤波流水线) 的吞吐
+
+typedef std::vector<unsigned char> Bytes;
+
+static void put32be(Bytes &out, unsigned int v)
+{
+    out.push_back((unsigned char)(v >> 24));
+    out.push_back((unsigned char)(v >> 16));
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+static unsigned int crc32(const unsigned char *p, size_t n, unsigned int crc = 0)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i)
+    {
+        crc ^= p[i];
+        for (int k = 0; k < 8; ++k)
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void putChunk(Bytes &out, const char *type, const Bytes &data)
+{
+    put32be(out, (unsigned int)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put32be(out, crc32(&out[start], out.size() - start));
+}
+
+// 只用固定 Huffman 表的字面量编码 zlib 流: 压缩率一般，但 inflate 要逐个符号解码，比 stored 块更接近真实文件
+static Bytes deflateLiterals(const Bytes &raw)
+{
+    Bytes out;
+    unsigned long long bits = 0;
+    int count = 0;
+    auto put = [&](unsigned int code, int len) {
+        bits |= (unsigned long long)code << count;
+        count += len;
+        while (count >= 8)
+        {
+            out.push_back((unsigned char)bits);
+            bits >>= 8;
+            count -= 8;
+        }
+    };
+    // Huffman 码要高位先出，而 deflate 按低位先写，所以要反转
+    auto putHuffman = [&](unsigned int code, int len) {
+        unsigned int r = 0;
+        for (int i = 0; i < len; ++i)
+            r |= ((code >> i) & 1) << (len - 1 - i);
+        put(r, len);
+    };
+
+    out.push_back(0x78);
+    out.push_back(0x01);
+    put(1, 1); // BFINAL
+    put(1, 2); // BTYPE = 固定 Huffman
+    for (unsigned char c : raw)
+    {
+        if (c < 144)
+            putHuffman(0x30 + c, 8);
+        else
+            putHuffman(0x190 + c - 144, 9);
+    }
+    putHuffman(0, 7); // 块结束
+    if (count)
+        put(0, 8 - count);
+
+    unsigned int a = 1, b = 0;
+    for (unsigned char c : raw)
+    {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32be(out, (b << 16) | a);
+    return out;
+}
+
+static int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+static Bytes makePng(int size, int channels, int filter)
+{
+    int stride = size * channels;
+    Bytes pixels((size_t)stride * size), raw;
+    srand(1);
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < stride; ++x)
+            pixels[(size_t)y * stride + x] = (unsigned char)(x / channels + y * 3 + (x % channels) * 40 + rand() % 8);
+
+    raw.reserve((size_t)(stride + 1) * size);
+    for (int y = 0; y < size; ++y)
+    {
+        const unsigned char *cur = &pixels[(size_t)y * stride];
+        const unsigned char *prior = y ? cur - stride : NULL;
+        raw.push_back((unsigned char)filter);
+        for (int x = 0; x < stride; ++x)
+        {
+            int a = x >= channels ? cur[x - channels] : 0;
+            int b = prior ? prior[x] : 0;
+            int c = prior && x >= channels ? prior[x - channels] : 0;
+            int predict[5] = { 0, a, b, (a + b) >> 1, paeth(a, b, c) };
+            raw.push_back((unsigned char)(cur[x] - predict[filter]));
+        }
+    }
+
+    Bytes png = { 137, 80, 78, 71, 13, 10, 26, 10 }, ihdr;
+    put32be(ihdr, size);
+    put32be(ihdr, size);
+    ihdr.push_back(8);
+    ihdr.push_back(channels == 4 ? 6 : 2);
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    putChunk(png, "IHDR", ihdr);
+    putChunk(png, "IDAT", deflateLiterals(raw));
+    putChunk(png, "IEND", Bytes());
+    return png;
+}
+
+// 返回解码后的 MB/s
+static double measure(const Bytes &png, int threads, int iterations)
+{
+    double bytes = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        int width, height, nrChannels;
+        unsigned char *data = threads
+            ? stbi_load_from_memory_parallel(&png[0], (int)png.size(), &width, &height, &nrChannels, 0, threads)
+            : stbi_load_from_memory(&png[0], (int)png.size(), &width, &height, &nrChannels, 0);
+        if (!data)
+        {
+            printf("failed to decode: %s\n", stbi_failure_reason());
+            return 0.0;
+        }
+        bytes += (double)width * height * nrChannels;
+        stbi_image_free(data);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return bytes / (1024.0 * 1024.0) / seconds;
+}
+
+int main(int argc, char **argv)
+{
+    int size = argc > 1 ? atoi(argv[1]) : 4096;
+    int iterations = argc > 2 ? atoi(argv[2]) : 5;
+    const char *filterNames[5] = { "none", "sub", "up", "avg", "paeth" };
+
+    printf("%dx%d, MB/s of decoded pixels\n", size, size);
+    printf("%-6s %-6s %10s %10s\n", "format", "filter", "serial", "pipelined");
+    for (int channels = 3; channels <= 4; ++channels)
+    {
+        for (int filter = 0; filter < 5; ++filter)
+        {
+            Bytes png = makePng(size, channels, filter);
+            double serial = measure(png, 0, iterations);
+            double pipelined = measure(png, 2, iterations);
+            printf("%-6s %-6s %10.1f %10.1f\n", channels == 4 ? "RGBA" : "RGB", filterNames[filter], serial, pipelined);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,745 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+
+// 用法: B04_Zlib_Inflate [重复次数] [png 文件...]
+// 先做一致性检查: 在内存里生成各种形状的 zlib 流 (压缩级别 0/1/6/9，default / filtered / huffman only /
+// rle / fixed 五种策略，512 字节和 32K 窗口，不 flush / sync flush / full flush)，原始数据是已知的，
+// 用 stbi_zlib_decode_malloc 和大小刚好的 stbi_zlib_decode_buffer 解码，64 位快速路径和逐字节版本
+// (B04_Zlib_Plain.cpp，-DSTBI_NO_ZLIB_FAST 编译) 都要还原出原始数据，截断的流都要报错。
+// 检查全部通过后，把 PNG 的 IDAT 拼成完整的 zlib 流，测两个版本 stbi_zlib_decode_malloc 的吞吐。
+
+// B04_Zlib_Plain.cpp 里关掉快速路径编译的同名函数
+char *plainZlibDecodeMalloc(const char *buffer, int len, int *outlen);
+int plainZlibDecodeBuffer(char *obuffer, int olen, const char *ibuffer, int ilen);
+
+typedef std::vector<unsigned char> Bytes;
+
+static bool readFile(const std::string &path, Bytes &out)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    fseek(f, 0, SEEK_END);
+    out.resize(ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = out.empty() || fread(&out[0], 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
+
+static unsigned int get32be(const unsigned char *p)
+{
+    return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// 取出所有 IDAT 数据
+static bool extractIdat(const Bytes &png, Bytes &zlib)
+{
+    size_t pos = 8;
+    zlib.clear();
+    while (pos + 8 <= png.size())
+    {
+        unsigned int length = get32be(&png[pos]);
+        if (pos + 12 + length > png.size())
+            return false;
+        if (memcmp(&png[pos + 4], "IDAT", 4) == 0)
+            zlib.insert(zlib.end(), png.begin() + pos + 8, png.begin() + pos + 8 + length);
+        pos += 12 + length;
+    }
+    return !zlib.empty();
+}
+
+// ---------------------------------------------------------------------------
+// 生成参考流用的 deflate 编码器: LZ77 (哈希链) + stored / 固定 Huffman / 动态 Huffman 块
+
+enum Strategy
+{
+    Default,
+    Filtered,    // 丢掉短匹配，多用字面量
+    HuffmanOnly, // 不找匹配
+    Rle,         // 只找距离为 1 的匹配
+    Fixed        // 只用固定 Huffman 表
+};
+enum Flush
+{
+    NoFlush,
+    SyncFlush, // 每段数据后面跟一个空的 stored 块，对齐到字节
+    FullFlush  // 同上，而且之后的匹配不能往回引用到 flush 之前
+};
+
+struct Shape
+{
+    int level; // 0 只出 stored 块，1/6/9 的哈希链越来越长
+    Strategy strategy;
+    int windowBits; // 9 (512 字节) 或 15 (32K)
+    Flush flush;
+};
+
+struct Token
+{
+    int length; // 0 表示字面量
+    int distance;
+    unsigned char literal;
+};
+
+static const int lengthBase[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int distanceBase[30] = { 1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                      193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+// 码长的码长按这个顺序写
+static const int codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static int lengthCode(int length)
+{
+    int code = 28;
+    while (lengthBase[code] > length)
+        --code;
+    return code;
+}
+
+static int distanceCode(int distance)
+{
+    int code = 29;
+    while (distanceBase[code] > distance)
+        --code;
+    return code;
+}
+
+// deflate 按低位先写
+struct BitWriter
+{
+    Bytes &out;
+    unsigned long long bits = 0;
+    int count = 0;
+
+    explicit BitWriter(Bytes &out) : out(out) {}
+    void put(unsigned int value, int length)
+    {
+        bits |= (unsigned long long)value << count;
+        count += length;
+        while (count >= 8)
+        {
+            out.push_back((unsigned char)bits);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+    // Huffman 码要高位先出，所以要反转
+    void putHuffman(unsigned int code, int length)
+    {
+        unsigned int r = 0;
+        for (int i = 0; i < length; ++i)
+            r |= ((code >> i) & 1) << (length - 1 - i);
+        put(r, length);
+    }
+    void align()
+    {
+        if (count)
+            put(0, 8 - count);
+    }
+};
+
+// 码长不超过 limit 的 Huffman 码长。超了就把频率减半再建，直到不超；
+// 至少给两个符号码长，和 zlib 一样不出只有一个码的表
+static std::vector<int> huffmanLengths(std::vector<unsigned int> freq, int limit)
+{
+    int used = 0;
+    for (unsigned int f : freq)
+        used += f > 0;
+    for (size_t i = 0; i < freq.size() && used < 2; ++i)
+    {
+        if (!freq[i])
+        {
+            freq[i] = 1;
+            ++used;
+        }
+    }
+    for (;;)
+    {
+        // 节点: 前 freq.size() 个是叶子，后面是合并出来的内部节点
+        std::vector<int> parent(freq.size() * 2, -1);
+        typedef std::pair<unsigned long long, int> Node;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> heap;
+        for (size_t i = 0; i < freq.size(); ++i)
+        {
+            if (freq[i])
+                heap.push(Node(freq[i], (int)i));
+        }
+        int next = (int)freq.size();
+        while (heap.size() > 1)
+        {
+            Node a = heap.top();
+            heap.pop();
+            Node b = heap.top();
+            heap.pop();
+            parent[a.second] = parent[b.second] = next;
+            heap.push(Node(a.first + b.first, next++));
+        }
+        std::vector<int> lengths(freq.size(), 0);
+        int longest = 0;
+        for (size_t i = 0; i < freq.size(); ++i)
+        {
+            if (!freq[i])
+                continue;
+            for (int n = parent[i]; n >= 0; n = parent[n])
+                ++lengths[i];
+            if (lengths[i] > longest)
+                longest = lengths[i];
+        }
+        if (longest <= limit)
+            return lengths;
+        for (unsigned int &f : freq)
+            f = (f + 1) / 2;
+    }
+}
+
+// 由码长得到规范 Huffman 码
+static std::vector<unsigned int> canonicalCodes(const std::vector<int> &lengths)
+{
+    int count[16] = { 0 };
+    unsigned int next[16] = { 0 };
+    for (int length : lengths)
+        count[length]++;
+    count[0] = 0;
+    unsigned int code = 0;
+    for (int bits = 1; bits < 16; ++bits)
+    {
+        code = (code + count[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    std::vector<unsigned int> codes(lengths.size(), 0);
+    for (size_t i = 0; i < lengths.size(); ++i)
+    {
+        if (lengths[i])
+            codes[i] = next[lengths[i]]++;
+    }
+    return codes;
+}
+
+// 把 [begin, end) 切成 token。匹配不越过 end，也不往回引用到 windowStart 之前或窗口之外
+struct Matcher
+{
+    const Bytes &raw;
+    Shape shape;
+    std::vector<int> head, prev;
+    size_t inserted = 0;
+
+    Matcher(const Bytes &raw, const Shape &shape) : raw(raw), shape(shape), head(1 << 15, -1), prev(raw.size(), -1) {}
+
+    int hash(size_t pos) const
+    {
+        return ((raw[pos] << 10) ^ (raw[pos + 1] << 5) ^ raw[pos + 2]) & 0x7fff;
+    }
+    void insertUpTo(size_t pos)
+    {
+        for (; inserted < pos; ++inserted)
+        {
+            if (inserted + 3 > raw.size())
+                continue;
+            int h = hash(inserted);
+            prev[inserted] = head[h];
+            head[h] = (int)inserted;
+        }
+    }
+    void tokens(size_t begin, size_t end, size_t windowStart, std::vector<Token> &out)
+    {
+        int maxChain = shape.level == 1 ? 4 : shape.level == 6 ? 128 : 4096;
+        int niceLength = shape.level == 1 ? 16 : shape.level == 6 ? 128 : 258;
+        int minLength = shape.strategy == Filtered ? 6 : 3;
+        size_t window = (size_t)1 << shape.windowBits;
+        for (size_t pos = begin; pos < end;)
+        {
+            insertUpTo(pos);
+            int limit = end - pos < 258 ? (int)(end - pos) : 258;
+            int bestLength = 0, bestDistance = 0;
+            if (limit >= 3 && shape.strategy == Rle)
+            {
+                if (pos > windowStart)
+                {
+                    while (bestLength < limit && raw[pos + bestLength] == raw[pos - 1])
+                        ++bestLength;
+                    bestDistance = 1;
+                }
+            }
+            else if (limit >= 3 && shape.strategy != HuffmanOnly)
+            {
+                int chain = maxChain;
+                for (int candidate = head[hash(pos)]; candidate >= 0 && chain-- > 0; candidate = prev[candidate])
+                {
+                    if ((size_t)candidate < windowStart || pos - candidate > window)
+                        break;
+                    int length = 0;
+                    while (length < limit && raw[candidate + length] == raw[pos + length])
+                        ++length;
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = (int)(pos - candidate);
+                        if (length >= niceLength)
+                            break;
+                    }
+                }
+            }
+            Token token = { 0, 0, raw[pos] };
+            if (bestLength >= minLength)
+            {
+                token.length = bestLength;
+                token.distance = bestDistance;
+            }
+            out.push_back(token);
+            pos += token.length ? token.length : 1;
+        }
+    }
+};
+
+static void storedBlock(BitWriter &w, const unsigned char *data, size_t size, bool final)
+{
+    w.put(final, 1);
+    w.put(0, 2);
+    w.align();
+    w.out.push_back((unsigned char)size);
+    w.out.push_back((unsigned char)(size >> 8));
+    w.out.push_back((unsigned char)~size);
+    w.out.push_back((unsigned char)(~size >> 8));
+    w.out.insert(w.out.end(), data, data + size);
+}
+
+static void huffmanBlock(BitWriter &w, const Token *tokens, size_t count, bool dynamic, bool final)
+{
+    std::vector<int> literalLengths(288, 0), distanceLengths(30, 0);
+    if (dynamic)
+    {
+        std::vector<unsigned int> literalFreq(286, 0), distanceFreq(30, 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (tokens[i].length)
+            {
+                literalFreq[257 + lengthCode(tokens[i].length)]++;
+                distanceFreq[distanceCode(tokens[i].distance)]++;
+            }
+            else
+                literalFreq[tokens[i].literal]++;
+        }
+        literalFreq[256] = 1;
+        literalLengths = huffmanLengths(literalFreq, 15);
+        distanceLengths = huffmanLengths(distanceFreq, 15);
+    }
+    else
+    {
+        for (int i = 0; i < 288; ++i)
+            literalLengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        for (int i = 0; i < 30; ++i)
+            distanceLengths[i] = 5;
+    }
+    std::vector<unsigned int> literalCodes = canonicalCodes(literalLengths), distanceCodes = canonicalCodes(distanceLengths);
+
+    w.put(final, 1);
+    w.put(dynamic ? 2 : 1, 2);
+    if (dynamic)
+    {
+        int literals = 286, distances = 30;
+        while (literals > 257 && !literalLengths[literals - 1])
+            --literals;
+        while (distances > 1 && !distanceLengths[distances - 1])
+            --distances;
+        // 两张表的码长连在一起，用 16 (重复前一个 3-6 次)、17 (3-10 个 0)、18 (11-138 个 0) 压缩
+        std::vector<int> all(literalLengths.begin(), literalLengths.begin() + literals);
+        all.insert(all.end(), distanceLengths.begin(), distanceLengths.begin() + distances);
+        std::vector<int> symbols, extras;
+        for (size_t i = 0; i < all.size();)
+        {
+            size_t run = 1;
+            while (i + run < all.size() && all[i + run] == all[i])
+                ++run;
+            if (all[i] == 0 && run >= 3)
+            {
+                size_t n = run < 138 ? run : 138;
+                symbols.push_back(n >= 11 ? 18 : 17);
+                extras.push_back((int)(n >= 11 ? n - 11 : n - 3));
+                i += n;
+            }
+            else if (all[i] != 0 && run >= 4)
+            {
+                size_t n = run - 1 < 6 ? run - 1 : 6;
+                symbols.push_back(all[i]);
+                extras.push_back(0);
+                symbols.push_back(16);
+                extras.push_back((int)(n - 3));
+                i += 1 + n;
+            }
+            else
+            {
+                symbols.push_back(all[i]);
+                extras.push_back(0);
+                ++i;
+            }
+        }
+        std::vector<unsigned int> codeLengthFreq(19, 0);
+        for (int symbol : symbols)
+            codeLengthFreq[symbol]++;
+        std::vector<int> codeLengthLengths = huffmanLengths(codeLengthFreq, 7);
+        std::vector<unsigned int> codeLengthCodes = canonicalCodes(codeLengthLengths);
+        int lengthsCount = 19;
+        while (lengthsCount > 4 && !codeLengthLengths[codeLengthOrder[lengthsCount - 1]])
+            --lengthsCount;
+
+        w.put(literals - 257, 5);
+        w.put(distances - 1, 5);
+        w.put(lengthsCount - 4, 4);
+        for (int i = 0; i < lengthsCount; ++i)
+            w.put(codeLengthLengths[codeLengthOrder[i]], 3);
+        for (size_t i = 0; i < symbols.size(); ++i)
+        {
+            w.putHuffman(codeLengthCodes[symbols[i]], codeLengthLengths[symbols[i]]);
+            if (symbols[i] >= 16)
+                w.put(extras[i], symbols[i] == 16 ? 2 : symbols[i] == 17 ? 3 : 7);
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Token &token = tokens[i];
+        if (!token.length)
+        {
+            w.putHuffman(literalCodes[token.literal], literalLengths[token.literal]);
+            continue;
+        }
+        int code = lengthCode(token.length);
+        w.putHuffman(literalCodes[257 + code], literalLengths[257 + code]);
+        w.put(token.length - lengthBase[code], lengthExtra[code]);
+        code = distanceCode(token.distance);
+        w.putHuffman(distanceCodes[code], distanceLengths[code]);
+        w.put(token.distance - distanceBase[code], distanceExtra[code]);
+    }
+    w.putHuffman(literalCodes[256], literalLengths[256]);
+}
+
+static unsigned int adler32(const Bytes &data)
+{
+    unsigned int a = 1, b = 0;
+    for (unsigned char c : data)
+    {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static Bytes deflate(const Bytes &raw, const Shape &shape)
+{
+    Bytes out;
+    unsigned int cmf = 8 | (shape.windowBits - 8) << 4;
+    unsigned int flg = (shape.level <= 1 ? 0 : shape.level == 6 ? 2 : 3) << 6;
+    flg += 31 - (cmf * 256 + flg) % 31;
+    out.push_back((unsigned char)cmf);
+    out.push_back((unsigned char)flg);
+
+    BitWriter w(out);
+    Matcher matcher(raw, shape);
+    // flush 时每段 3001 字节，段和段之间是一个空的 stored 块
+    size_t segment = shape.flush == NoFlush || raw.empty() ? raw.size() + 1 : 3001;
+    const size_t blockTokens = 16384, blockBytes = 65535;
+    for (size_t begin = 0;; begin += segment)
+    {
+        size_t end = begin + segment < raw.size() ? begin + segment : raw.size();
+        bool last = end == raw.size();
+        if (shape.level == 0)
+        {
+            size_t at = begin;
+            do
+            {
+                size_t n = end - at < blockBytes ? end - at : blockBytes;
+                storedBlock(w, raw.data() + at, n, last && at + n == end);
+                at += n;
+            } while (at < end);
+        }
+        else
+        {
+            std::vector<Token> tokens;
+            matcher.tokens(begin, end, shape.flush == FullFlush ? begin : 0, tokens);
+            size_t at = 0;
+            do
+            {
+                size_t n = tokens.size() - at < blockTokens ? tokens.size() - at : blockTokens;
+                huffmanBlock(w, tokens.data() + at, n, shape.strategy != Fixed, last && at + n == tokens.size());
+                at += n;
+            } while (at < tokens.size());
+        }
+        if (last)
+            break;
+        storedBlock(w, nullptr, 0, false);
+    }
+    w.align();
+    unsigned int adler = adler32(raw);
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((unsigned char)(adler >> shift));
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// 一致性检查
+
+struct Sample
+{
+    const char *name;
+    Bytes raw;
+};
+
+static unsigned int randomState = 12345;
+static unsigned int nextRandom()
+{
+    randomState = randomState * 1103515245u + 12345u;
+    return randomState >> 8;
+}
+
+static std::vector<Sample> makeSamples()
+{
+    std::vector<Sample> samples;
+    samples.push_back({ "empty", Bytes() });
+    samples.push_back({ "one byte", Bytes(1, 'x') });
+
+    // 一小堆单词随机拼成的文本: 各种距离、长度不一的匹配
+    const char *words[] = { "the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "texture ",
+                            "shader ", "vertex ", "buffer ", "\n", "glBindTexture(GL_TEXTURE_2D, ", "); " };
+    Bytes text;
+    while (text.size() < 40000)
+    {
+        const char *word = words[nextRandom() % (sizeof(words) / sizeof(words[0]))];
+        text.insert(text.end(), word, word + strlen(word));
+    }
+    samples.push_back({ "text", text });
+
+    // 不可压缩
+    Bytes noise(20000);
+    for (unsigned char &c : noise)
+        c = (unsigned char)nextRandom();
+    samples.push_back({ "random", noise });
+
+    // 长短不一的重复字节: 距离 1 的重叠拷贝和 258 长度的匹配
+    Bytes runs;
+    while (runs.size() < 50000)
+        runs.insert(runs.end(), 1 + nextRandom() % 600, (unsigned char)nextRandom());
+    samples.push_back({ "runs", runs });
+
+    // 周期 1-9 的重复片段: 距离小于 8 的重叠拷贝
+    Bytes periodic;
+    while (periodic.size() < 50000)
+    {
+        int period = 1 + nextRandom() % 9;
+        size_t start = periodic.size();
+        for (int i = 0; i < period; ++i)
+            periodic.push_back((unsigned char)nextRandom());
+        size_t length = 10 + nextRandom() % 1000;
+        for (size_t i = period; i < length; ++i)
+            periodic.push_back(periodic[start + i - period]);
+    }
+    samples.push_back({ "periodic", periodic });
+
+    // 像 PNG 的 IDAT: 每行一个 filter 字节，后面是带一点噪声的渐变
+    Bytes rows;
+    for (int y = 0; y < 200; ++y)
+    {
+        rows.push_back((unsigned char)(y % 5));
+        for (int x = 0; x < 150 * 3; ++x)
+            rows.push_back((unsigned char)(x / 3 + y + ((x % 3) * 40) + (nextRandom() % 4)));
+    }
+    samples.push_back({ "image rows", rows });
+    return samples;
+}
+
+static std::string shapeName(const Shape &shape)
+{
+    const char *strategies[] = { "default", "filtered", "huffman only", "rle", "fixed" };
+    const char *flushes[] = { "no flush", "sync flush", "full flush" };
+    return "level " + std::to_string(shape.level) + ", " + strategies[shape.strategy] + ", " +
+           std::to_string(1 << shape.windowBits) + " window, " + flushes[shape.flush];
+}
+
+typedef char *(*DecodeMalloc)(const char *buffer, int len, int *outlen);
+typedef int (*DecodeBuffer)(char *obuffer, int olen, const char *ibuffer, int ilen);
+
+// 解码结果: 失败时 ok 为 false
+struct Decoded
+{
+    bool ok;
+    Bytes data;
+    bool operator==(const Decoded &other) const { return ok == other.ok && data == other.data; }
+};
+
+static Decoded decodeMalloc(DecodeMalloc decode, const unsigned char *in, size_t size)
+{
+    int outlen = 0;
+    char *out = decode((const char *)in, (int)size, &outlen);
+    Decoded result = { out != nullptr, Bytes() };
+    if (out)
+    {
+        result.data.assign(out, out + outlen);
+        free(out);
+    }
+    return result;
+}
+
+// 输出缓冲是一块正好 capacity 大的堆内存，越界写会被 ASan 抓到 (capacity 为 0 时也不是空指针)
+static Decoded decodeBuffer(DecodeBuffer decode, const unsigned char *in, size_t size, size_t capacity)
+{
+    std::unique_ptr<char[]> out(new char[capacity]);
+    int written = decode(out.get(), (int)capacity, (const char *)in, (int)size);
+    Decoded result = { written >= 0, Bytes() };
+    if (written >= 0)
+        result.data.assign(out.get(), out.get() + written);
+    return result;
+}
+
+// 检查一个流，返回出错的地方，全对返回空串
+static std::string checkStream(const Bytes &raw, const Bytes &stream, int &decodes)
+{
+    const struct
+    {
+        const char *name;
+        DecodeMalloc decodeMalloc;
+        DecodeBuffer decodeBuffer;
+    } builds[] = { { "fast", stbi_zlib_decode_malloc, stbi_zlib_decode_buffer },
+                   { "plain", plainZlibDecodeMalloc, plainZlibDecodeBuffer } };
+    Decoded expected = { true, raw };
+    for (const auto &build : builds)
+    {
+        decodes += 3;
+        if (!(decodeMalloc(build.decodeMalloc, stream.data(), stream.size()) == expected))
+            return std::string(build.name) + " malloc";
+        if (!(decodeBuffer(build.decodeBuffer, stream.data(), stream.size(), raw.size()) == expected))
+            return std::string(build.name) + " exact buffer";
+        if (!raw.empty() && decodeBuffer(build.decodeBuffer, stream.data(), stream.size(), raw.size() - 1).ok)
+            return std::string(build.name) + " buffer one byte short didn't fail";
+    }
+
+    // 截断的流: stb_image 不校验 adler32，所以只截掉 adler32 的要解对，截到 deflate 数据的要报错
+    size_t cuts[] = { 0, 1, 2, 3, stream.size() / 3, stream.size() / 2, stream.size() - 7, stream.size() - 6,
+                      stream.size() - 5, stream.size() - 4, stream.size() - 1 };
+    for (size_t cut : cuts)
+    {
+        if (cut >= stream.size())
+            continue;
+        // 截断的输入也放进一块正好大小的堆内存，读过头会被 ASan 抓到
+        Bytes in(stream.begin(), stream.begin() + cut);
+        Decoded want = { cut >= stream.size() - 4, cut >= stream.size() - 4 ? raw : Bytes() };
+        for (const auto &build : builds)
+        {
+            decodes += 2;
+            if (!(decodeMalloc(build.decodeMalloc, in.data(), in.size()) == want))
+                return std::string(build.name) + " malloc, cut to " + std::to_string(cut) + " bytes";
+            if (!(decodeBuffer(build.decodeBuffer, in.data(), in.size(), raw.size()) == want))
+                return std::string(build.name) + " exact buffer, cut to " + std::to_string(cut) + " bytes";
+        }
+    }
+    return std::string();
+}
+
+// 返回出错的流的个数
+static int checkConformance()
+{
+    std::vector<Sample> samples = makeSamples();
+    std::vector<Shape> shapes;
+    const int levels[] = { 0, 1, 6, 9 };
+    for (int level : levels)
+    {
+        for (int strategy = Default; strategy <= Fixed; ++strategy)
+        {
+            // stored 块和策略无关
+            if (level == 0 && strategy != Default)
+                continue;
+            for (int windowBits : { 9, 15 })
+            {
+                for (int flush = NoFlush; flush <= FullFlush; ++flush)
+                    shapes.push_back({ level, (Strategy)strategy, windowBits, (Flush)flush });
+            }
+        }
+    }
+
+    int streams = 0, decodes = 0, failures = 0;
+    for (const Shape &shape : shapes)
+    {
+        for (const Sample &sample : samples)
+        {
+            Bytes stream = deflate(sample.raw, shape);
+            ++streams;
+            std::string error = checkStream(sample.raw, stream, decodes);
+            if (!error.empty())
+            {
+                if (++failures <= 10)
+                    printf("MISMATCH %s, %s: %s\n", sample.name, shapeName(shape).c_str(), error.c_str());
+            }
+        }
+    }
+    printf("conformance: %d streams, %d decodes, %d mismatches\n\n", streams, decodes, failures);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; ++i)
+        files.push_back(argv[i]);
+    if (files.empty())
+    {
+        const char *textures[] = { "awesomeface.png", "container2.png", "container2_specular.png", "concreteTexture.png", "grass.png" };
+        for (const char *name : textures)
+            files.push_back(FileSystem::getPath(std::string("resources/textures/") + name));
+    }
+
+    if (checkConformance())
+        return 1;
+
+    printf("%-40s %10s %10s %12s %12s %9s\n", "file", "in KB", "out KB", "fast MB/s", "plain MB/s", "speedup");
+    for (const std::string &path : files)
+    {
+        const char *name = strrchr(path.c_str(), '/');
+        name = name ? name + 1 : path.c_str();
+        Bytes png, zlib;
+        if (!readFile(path, png) || !extractIdat(png, zlib))
+        {
+            printf("%-40s can't read IDAT\n", name);
+            continue;
+        }
+        // 真实文件没有原始数据可比，两个版本解出来要一样
+        Decoded fast = decodeMalloc(stbi_zlib_decode_malloc, zlib.data(), zlib.size());
+        if (!fast.ok)
+        {
+            printf("%-40s inflate failed: %s\n", name, stbi_failure_reason());
+            continue;
+        }
+        if (!(fast == decodeMalloc(plainZlibDecodeMalloc, zlib.data(), zlib.size())))
+        {
+            printf("%-40s MISMATCH between fast and plain\n", name);
+            return 1;
+        }
+
+        double seconds[2] = { 0.0, 0.0 };
+        DecodeMalloc decoders[2] = { stbi_zlib_decode_malloc, plainZlibDecodeMalloc };
+        for (int d = 0; d < 2; ++d)
+        {
+            for (int i = 0; i < iterations; ++i)
+            {
+                int outlen = 0;
+                auto start = std::chrono::steady_clock::now();
+                char *out = decoders[d]((const char *)&zlib[0], (int)zlib.size(), &outlen);
+                seconds[d] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                free(out);
+            }
+        }
+        double outMB = fast.data.size() * (double)iterations / (1024.0 * 1024.0);
+        printf("%-40s %10.1f %10.1f %12.1f %12.1f %8.2fx\n", name, zlib.size() / 1024.0, fast.data.size() / 1024.0,
+               outMB / seconds[0], outMB / seconds[1], seconds[1] / seconds[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+// B04 要在同一个程序里对比两种 inflate，所以这里再单独编译一份 static 的实现：
+// 只带 zlib 解码，关掉 64 位 bit buffer 的快速路径。用到的只有下面两个函数，
+// 其余 static 函数没用到、没有图片格式时加载入口的参数没用到都是正常的，不报警告
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_ZLIB
+#define STBI_SUPPORT_ZLIB
+#define STBI_NO_ZLIB_FAST
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#include <stb_image.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+char *plainZlibDecodeMalloc(const char *buffer, int len, int *outlen)
+{
+    return stbi_zlib_decode_malloc(buffer, len, outlen);
+}
+
+int plainZlibDecodeBuffer(char *obuffer, int olen, const char *ibuffer, int ilen)
+{
+    return stbi_zlib_decode_buffer(obuffer, olen, ibuffer, ilen);
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+
+// 用法: B05_Mapped_Load [每个文件读取的 MB 数] [放大后的 PPM 大小 MB]
+// 对比 stbi_load (stdio, 128 字节一次 refill) 和 stbi_load_mapped (mmap) 的读取+解码速度。
+// 第一张表直接读 resources/textures 里的图片，重复加载直到累计读够指定的文件字节数；
+// 第二张表把每张纹理平铺成一个几百 MB 的二进制 PPM，几乎没有解码开销，只剩 I/O 路径本身。
+// 两种方式都先预热一次，测的是文件已经在 page cache 里的情况。
+
+typedef unsigned char *(*LoadFunc)(const char *path, int *x, int *y, int *n, int req);
+
+static long fileSize(const std::string &path)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+// 返回读取的文件 MB/s，失败返回 0
+static double measure(LoadFunc load, const std::string &path, long size, int iterations)
+{
+    int width, height, nrChannels;
+    unsigned char *data = load(path.c_str(), &width, &height, &nrChannels, 0);
+    if (!data)
+    {
+        printf("failed to load %s: %s\n", path.c_str(), stbi_failure_reason());
+        return 0.0;
+    }
+    stbi_image_free(data);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        stbi_image_free(load(path.c_str(), &width, &height, &nrChannels, 0));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (double)size * iterations / (1024.0 * 1024.0) / seconds;
+}
+
+// 把图片横竖平铺，写成大约 targetMB 大小的 PPM (灰度/带 alpha 的图只取 RGB)
+static bool writeTiledPPM(const std::string &src, const std::string &dst, int targetMB)
+{
+    int width, height, nrChannels;
+    unsigned char *data = stbi_load(src.c_str(), &width, &height, &nrChannels, 3);
+    if (!data)
+        return false;
+
+    double scale = (double)targetMB * 1024.0 * 1024.0 / ((double)width * height * 3);
+    int tiles = 1;
+    while ((double)tiles * tiles < scale)
+        ++tiles;
+    FILE *f = fopen(dst.c_str(), "wb");
+    if (!f)
+    {
+        stbi_image_free(data);
+        return false;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", width * tiles, height * tiles);
+    std::vector<unsigned char> row((size_t)width * tiles * 3);
+    bool ok = true;
+    for (int y = 0; y < height * tiles && ok; ++y)
+    {
+        for (int t = 0; t < tiles; ++t)
+            memcpy(&row[(size_t)t * width * 3], data + (size_t)(y % height) * width * 3, (size_t)width * 3);
+        ok = fwrite(&row[0], 1, row.size(), f) == row.size();
+    }
+    fclose(f);
+    stbi_image_free(data);
+    return ok;
+}
+
+static void printRow(const std::string &path, long size, double stdioSpeed, double mappedSpeed)
+{
+    const char *name = strrchr(path.c_str(), '/');
+    printf("%-32s %10.1f %12.1f %12.1f %8.2fx\n", name ? name + 1 : path.c_str(), size / (1024.0 * 1024.0), stdioSpeed,
+           mappedSpeed, stdioSpeed > 0.0 ? mappedSpeed / stdioSpeed : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    int readMB = argc > 1 ? atoi(argv[1]) : 256;
+    int scaledMB = argc > 2 ? atoi(argv[2]) : 256;
+    const char *textures[] = { "awesomeface.png", "background.jpg", "brickwall.jpg", "brickwall_normal.jpg",
+                               "concreteTexture.png", "container.jpg", "container2.png", "grass.png" };
+
+    printf("%-32s %10s %12s %12s %9s\n", "file", "MB", "stdio MB/s", "mmap MB/s", "speedup");
+    for (const char *texture : textures)
+    {
+        std::string path = FileSystem::getPath(std::string("resources/textures/") + texture);
+        long size = fileSize(path);
+        if (size <= 0)
+        {
+            printf("%-32s can't open\n", texture);
+            continue;
+        }
+        int iterations = (int)((double)readMB * 1024.0 * 1024.0 / size) + 1;
+        double stdioSpeed = measure(stbi_load, path, size, iterations);
+        double mappedSpeed = measure(stbi_load_mapped, path, size, iterations);
+        printRow(path, size, stdioSpeed, mappedSpeed);
+    }
+
+    printf("\n%-32s %10s %12s %12s %9s\n", "tiled ppm", "MB", "stdio MB/s", "mmap MB/s", "speedup");
+    for (const char *texture : textures)
+    {
+        std::string path = FileSystem::getPath(std::string("resources/textures/") + texture);
+        std::string scaled = std::string("B05_") + texture + ".ppm";
+        if (!writeTiledPPM(path, scaled, scaledMB))
+        {
+            printf("%-32s can't write %s\n", texture, scaled.c_str());
+            remove(scaled.c_str());
+            continue;
+        }
+        long size = fileSize(scaled);
+        double stdioSpeed = measure(stbi_load, scaled, size, 3);
+        double mappedSpeed = measure(stbi_load_mapped, scaled, size, 3);
+        printRow(scaled, size, stdioSpeed, mappedSpeed);
+        remove(scaled.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+
+// 用法: B06_Progressive_Stream [JPEG 路径] [每次到达的 KB 数]
+// 模拟边下载边显示：把文件按块喂给 stbi_jpeg_stream，每次画面更新时取一张图，
+// 打印这时已经到达了多少字节、解码累计花了多少时间，最后和一次性 stbi_load_from_memory 对比。
+// 渐进式 JPEG (例如 cjpeg -progressive) 在第一个 DC scan 到达后就有 1/8 预览；
+// 基线 JPEG 要等全部到达才有图。
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : FileSystem::getPath("resources/textures/container.jpg");
+    int chunkKB = argc > 2 ? atoi(argv[2]) : 16;
+    if (chunkKB < 1)
+        chunkKB = 1;
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        printf("failed to open %s\n", path.c_str());
+        return -1;
+    }
+    std::vector<unsigned char> file;
+    unsigned char buffer[65536];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        file.insert(file.end(), buffer, buffer + got);
+    fclose(f);
+
+    int width, height, nrChannels;
+    auto start = std::chrono::steady_clock::now();
+    unsigned char *data = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &nrChannels, 4);
+    double fullMs = elapsedMs(start);
+    if (!data)
+    {
+        printf("failed to load %s: %s\n", path.c_str(), stbi_failure_reason());
+        return -1;
+    }
+    stbi_image_free(data);
+    printf("%s %dx%dx%d, %.1f KB\n", path.c_str(), width, height, nrChannels, file.size() / 1024.0);
+
+    // 只计解码时间，不计"下载"
+    stbi_load_options options = {};
+    options.desired_channels = 4;
+    stbi_jpeg_stream *stream = stbi_jpeg_stream_begin(&options);
+    size_t chunk = (size_t)chunkKB * 1024, offset = 0;
+    double decodeMs = 0.0, firstMs = -1.0;
+    size_t firstBytes = 0;
+    int result = STBI_stream_more;
+    printf("%10s %8s %12s %10s\n", "arrived", "%", "decode ms", "image");
+    while (offset < file.size() && result != STBI_stream_error && result != STBI_stream_done)
+    {
+        size_t len = file.size() - offset < chunk ? file.size() - offset : chunk;
+        start = std::chrono::steady_clock::now();
+        result = stbi_jpeg_stream_feed(stream, file.data() + offset, (int)len);
+        offset += len;
+        if (result == STBI_stream_updated || result == STBI_stream_done)
+        {
+            int x, y, n, scale;
+            data = stbi_jpeg_stream_image(stream, &x, &y, &n, &scale);
+            decodeMs += elapsedMs(start);
+            if (!data)
+                break;
+            stbi_image_free(data);
+            if (firstMs < 0.0)
+            {
+                firstMs = decodeMs;
+                firstBytes = offset;
+            }
+            printf("%10zu %7.1f%% %12.2f %5dx%-5d 1/%d\n", offset, 100.0 * offset / file.size(), decodeMs, x, y, scale);
+        }
+        else
+            decodeMs += elapsedMs(start);
+    }
+    stbi_jpeg_stream_end(stream);
+    if (result == STBI_stream_error)
+    {
+        printf("stream failed: %s\n", stbi_failure_reason());
+        return -1;
+    }
+
+    printf("stbi_load_from_memory: image after 100%% of the file, %.2f ms\n", fullMs);
+    printf("stbi_jpeg_stream:      image after %.1f%% of the file, %.2f ms; %.2f ms decoding in total\n",
+           100.0 * firstBytes / file.size(), firstMs, decodeMs);
+    return 0;
+}
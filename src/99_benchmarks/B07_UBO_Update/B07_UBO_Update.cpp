@@ -0,0 +1,172 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <learnopengl/shader_s.h>
+#include <learnopengl/uniform_buffer.h>
+
+// 用法: B07_UBO_Update [每个 N 跑的帧数]
+// 对比每帧用 N 次 setFloat (每次一个 glUniform1f) 和把 N 个 float 用 Std140Writer
+// 写进 UniformRing、每帧一次更新的耗时，N = 10 .. 10000。
+// 每帧的值都不一样，setFloat 的缓存跳不过任何一次上传；每帧画一个很小的三角形让驱动真正用上这些值。
+// 默认 uniform 块放不下 10000 个 float 时，setFloat 轮流写数组里的元素 (调用次数不变)；
+// UBO 按 vec4 打包，超过 GL_MAX_UNIFORM_BLOCK_SIZE 的部分截掉，表里会标出实际大小。
+
+static const char *vertexCode =
+    "#version 330 core\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 p = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 0.01;\n"
+    "    gl_Position = vec4(p, 0.0, 1.0);\n"
+    "}\n";
+
+// 默认 uniform 块: float values[COUNT]，用动态下标保证整个数组都是 active 的
+static std::string defaultBlockFragment(int count)
+{
+    return "#version 330 core\n"
+           "#define COUNT " + std::to_string(count) + "\n"
+           "uniform float values[COUNT];\n"
+           "out vec4 FragColor;\n"
+           "void main()\n"
+           "{\n"
+           "    FragColor = vec4(values[int(gl_FragCoord.x) % COUNT]);\n"
+           "}\n";
+}
+
+// std140 块: vec4 values[COUNT]，每个 vec4 装 4 个 float
+static std::string uniformBlockFragment(int count)
+{
+    return "#version 330 core\n"
+           "#define COUNT " + std::to_string(count) + "\n"
+           "layout(std140) uniform Values\n"
+           "{\n"
+           "    vec4 values[COUNT];\n"
+           "};\n"
+           "out vec4 FragColor;\n"
+           "void main()\n"
+           "{\n"
+           "    int i = int(gl_FragCoord.x) % (COUNT * 4);\n"
+           "    FragColor = vec4(values[i / 4][i % 4]);\n"
+           "}\n";
+}
+
+// 先画一次再计时，不把第一次 draw 时驱动的编译算进去
+static void warmUp(Shader &shader)
+{
+    shader.use();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glFinish();
+}
+
+// 返回每帧的微秒数
+static double measureUniforms(int n, int frames)
+{
+    // 保守地按每个 float 元素占一个 vec4 的位置算
+    int maxComponents = 0;
+    glGetIntegerv(GL_MAX_FRAGMENT_UNIFORM_COMPONENTS, &maxComponents);
+    int maxVectors = maxComponents / 4;
+    int count = n < maxVectors - 16 ? n : maxVectors - 16;
+    Shader shader = Shader::fromSource(vertexCode, defaultBlockFragment(count));
+    std::vector<UniformHandle> handles(count);
+    for (int i = 0; i < count; ++i)
+        handles[i] = shader.uniform("values[" + std::to_string(i) + "]");
+    warmUp(shader);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        shader.use();
+        for (int i = 0; i < n; ++i)
+            shader.setFloat(handles[i % count], (float)(frame + i));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glFinish();
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+    glDeleteProgram(shader.ID);
+    return us;
+}
+
+static double measureUniformBlock(int n, int frames, int &vec4s)
+{
+    int maxBlockSize = 0;
+    glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+    vec4s = (n + 3) / 4;
+    if (vec4s * 16 > maxBlockSize)
+        vec4s = maxBlockSize / 16;
+    Shader shader = Shader::fromSource(vertexCode, uniformBlockFragment(vec4s));
+    shader.bindUniformBlock("Values", 0);
+    size_t size = (size_t)shader.uniformBlockSize("Values");
+    UniformRing ring(size);
+    std::vector<float> values((size_t)vec4s * 4);
+    warmUp(shader);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        ring.beginFrame();
+        UniformRange range = ring.allocate(size);
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = (float)(frame + (int)i);
+        range.writer().putVec4Array(values.data(), (size_t)vec4s);
+        ring.flush();
+        range.bind(0);
+        shader.use();
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glFinish();
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / frames;
+    glDeleteProgram(shader.ID);
+    return us;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    // 只要一个 context，不显示窗口
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "B07_UBO_Update", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        printf("failed to initialize GLAD\n");
+        return -1;
+    }
+    glViewport(0, 0, 64, 64);
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+
+    printf("%s, %s\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+    printf("UBO updates through %s\n\n", GLAD_GL_ARB_buffer_storage ? "a persistent mapping" : "an unsynchronized mapping");
+    printf("%8s %16s %16s %10s %9s\n", "N", "setFloat us/f", "UBO us/f", "UBO bytes", "speedup");
+    const int counts[] = {10, 30, 100, 300, 1000, 3000, 10000};
+    for (int n : counts)
+    {
+        int vec4s = 0;
+        double uniforms = measureUniforms(n, frames);
+        double block = measureUniformBlock(n, frames, vec4s);
+        printf("%8d %16.1f %16.1f %10d %8.2fx\n", n, uniforms, block, vec4s * 16, uniforms / block);
+    }
+
+    glDeleteVertexArrays(1, &VAO);
+    glfwTerminate();
+    return 0;
+}
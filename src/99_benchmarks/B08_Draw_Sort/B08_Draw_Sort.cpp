@@ -0,0 +1,321 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <learnopengl/shader_s.h>
+#include <learnopengl/render_state.h>
+#include <learnopengl/draw_queue.h>
+
+// 用法: B08_Draw_Sort [帧数] [录制线程数]
+// 10 万个小方块，每个随机选一个 program (8 个)、一组贴图 (16 组，每组 2 张) 和一个 VAO (4 个)。
+// 对比四种提交方式每帧的耗时和真正调用的状态切换次数：
+//   immediate   按录制顺序直接调 GL，每个方块都切一次 program / 贴图 / VAO (和 demo 的写法一样)
+//   filtered    按录制顺序经过 RenderState，只省掉和上一个方块相同的切换
+//   sorted      录进 DrawQueue，按 64 位 key 基数排序后再经过 RenderState 提交
+//   threaded    同 sorted，但由多个线程各录一部分
+// 每个方块的位置用一个 vec4 uniform 传，四种方式的 draw 次数和 uniform 次数都一样。
+
+static const int quadCount = 100000;
+static const int programCount = 8;
+static const int textureSetCount = 16;
+static const int vaoCount = 4;
+static const int textureCount = 8;
+
+static const char *vertexCode =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "uniform vec4 placement; // xy 位置, z 大小, w 深度\n"
+    "out vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    uv = aPos * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(placement.xy + aPos * placement.z, placement.w, 1.0);\n"
+    "}\n";
+
+static std::string fragmentCode(int program)
+{
+    return "#version 330 core\n"
+           "in vec2 uv;\n"
+           "uniform sampler2D tex0;\n"
+           "uniform sampler2D tex1;\n"
+           "out vec4 FragColor;\n"
+           "void main()\n"
+           "{\n"
+           "    vec4 tint = vec4(" + std::to_string((program & 1) * 0.5 + 0.5) + ", " +
+           std::to_string((program >> 1 & 1) * 0.5 + 0.5) + ", " + std::to_string((program >> 2 & 1) * 0.5 + 0.5) + ", 1.0);\n"
+           "    FragColor = tint * mix(texture(tex0, uv), texture(tex1, uv), 0.5);\n"
+           "}\n";
+}
+
+struct Quad
+{
+    int program, textureSet, vao;
+    float placement[4];
+};
+
+struct Scene
+{
+    std::vector<Shader> programs;
+    std::vector<int> placementLocations;
+    unsigned int textures[textureCount];
+    unsigned int textureSets[textureSetCount][2];
+    unsigned int vaos[vaoCount], vbos[vaoCount], ebo;
+    std::vector<Quad> quads;
+};
+
+static void createScene(Scene &scene)
+{
+    for (int i = 0; i < programCount; ++i)
+    {
+        scene.programs.push_back(Shader::fromSource(vertexCode, fragmentCode(i)));
+        Shader &shader = scene.programs.back();
+        shader.use();
+        shader.setInt("tex0", 0);
+        shader.setInt("tex1", 1);
+        scene.placementLocations.push_back(glGetUniformLocation(shader.ID, "placement"));
+    }
+
+    glGenTextures(textureCount, scene.textures);
+    for (int i = 0; i < textureCount; ++i)
+    {
+        unsigned char pixels[4 * 4 * 4];
+        for (int p = 0; p < 16; ++p)
+        {
+            pixels[p * 4 + 0] = (unsigned char)(i * 32);
+            pixels[p * 4 + 1] = (unsigned char)(p * 16);
+            pixels[p * 4 + 2] = (unsigned char)(255 - i * 32);
+            pixels[p * 4 + 3] = 255;
+        }
+        glBindTexture(GL_TEXTURE_2D, scene.textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 4, 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    for (int i = 0; i < textureSetCount; ++i)
+    {
+        scene.textureSets[i][0] = scene.textures[i % textureCount];
+        scene.textureSets[i][1] = scene.textures[(i / textureCount + i + 1) % textureCount];
+    }
+
+    // 4 个 VAO 的方块形状略有不同，共用一个 EBO
+    unsigned int indices[] = {0, 1, 3, 1, 2, 3};
+    glGenVertexArrays(vaoCount, scene.vaos);
+    glGenBuffers(vaoCount, scene.vbos);
+    glGenBuffers(1, &scene.ebo);
+    for (int i = 0; i < vaoCount; ++i)
+    {
+        float s = 1.0f - i * 0.1f;
+        float vertices[] = {s, s, s, -1.0f, -1.0f, -1.0f, -1.0f, s};
+        glBindVertexArray(scene.vaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, scene.vbos[i]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, scene.ebo);
+        if (i == 0)
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+    }
+    glBindVertexArray(0);
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    scene.quads.resize(quadCount);
+    for (Quad &quad : scene.quads)
+    {
+        quad.program = (int)(random() % programCount);
+        quad.textureSet = (int)(random() % textureSetCount);
+        quad.vao = (int)(random() % vaoCount);
+        quad.placement[0] = unit(random) * 2.0f - 1.0f;
+        quad.placement[1] = unit(random) * 2.0f - 1.0f;
+        quad.placement[2] = 0.005f + unit(random) * 0.01f;
+        quad.placement[3] = unit(random);
+    }
+}
+
+static void deleteScene(Scene &scene)
+{
+    for (Shader &shader : scene.programs)
+        glDeleteProgram(shader.ID);
+    glDeleteTextures(textureCount, scene.textures);
+    glDeleteVertexArrays(vaoCount, scene.vaos);
+    glDeleteBuffers(vaoCount, scene.vbos);
+    glDeleteBuffers(1, &scene.ebo);
+}
+
+static void drawImmediate(Scene &scene)
+{
+    for (const Quad &quad : scene.quads)
+    {
+        glUseProgram(scene.programs[quad.program].ID);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, scene.textureSets[quad.textureSet][0]);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, scene.textureSets[quad.textureSet][1]);
+        glBindVertexArray(scene.vaos[quad.vao]);
+        glUniform4fv(scene.placementLocations[quad.program], 1, quad.placement);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+}
+
+static void drawFiltered(Scene &scene, RenderState &state)
+{
+    for (const Quad &quad : scene.quads)
+    {
+        state.useProgram(scene.programs[quad.program].ID);
+        state.bindTexture(0, GL_TEXTURE_2D, scene.textureSets[quad.textureSet][0]);
+        state.bindTexture(1, GL_TEXTURE_2D, scene.textureSets[quad.textureSet][1]);
+        state.bindVertexArray(scene.vaos[quad.vao]);
+        glUniform4fv(scene.placementLocations[quad.program], 1, quad.placement);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+}
+
+// 录制 [begin, end) 的方块，不调用任何 GL 函数
+static void record(const Scene &scene, CommandBuffer &buffer, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        const Quad &quad = scene.quads[i];
+        DrawCommand command;
+        // 不透明的方块: 同一状态内由近到远
+        command.key = DrawKey::make(0, quad.program, quad.textureSet, quad.vao, quad.placement[3]);
+        command.program = scene.programs[quad.program].ID;
+        command.textures[0] = scene.textureSets[quad.textureSet][0];
+        command.textures[1] = scene.textureSets[quad.textureSet][1];
+        command.vertexArray = scene.vaos[quad.vao];
+        command.count = 6;
+        command.paramLocation = scene.placementLocations[quad.program];
+        for (int c = 0; c < 4; ++c)
+            command.param[c] = quad.placement[c];
+        buffer.draw(command);
+    }
+}
+
+static void drawSorted(Scene &scene, RenderState &state, DrawQueue &queue)
+{
+    size_t threads = queue.threads();
+    if (threads == 1)
+        record(scene, queue.buffer(0), 0, scene.quads.size());
+    else
+    {
+        std::vector<std::thread> workers;
+        size_t chunk = (scene.quads.size() + threads - 1) / threads;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            size_t begin = t * chunk < scene.quads.size() ? t * chunk : scene.quads.size();
+            size_t end = begin + chunk < scene.quads.size() ? begin + chunk : scene.quads.size();
+            workers.emplace_back(record, std::cref(scene), std::ref(queue.buffer(t)), begin, end);
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+    queue.submit(state);
+}
+
+enum Mode
+{
+    Immediate,
+    Filtered,
+    Sorted,
+    Threaded
+};
+
+// 返回每帧的毫秒数；stateCalls 为每帧真正调用的状态切换次数
+static double measure(Scene &scene, Mode mode, int frames, size_t threads, double &stateCalls)
+{
+    RenderState state;
+    DrawQueue queue(mode == Threaded ? threads : 1);
+    for (size_t t = 0; t < queue.threads(); ++t)
+        queue.buffer(t).reserve(scene.quads.size() / queue.threads() + 1);
+
+    auto frame = [&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (mode == Immediate)
+            drawImmediate(scene);
+        else if (mode == Filtered)
+            drawFiltered(scene, state);
+        else
+            drawSorted(scene, state, queue);
+    };
+    // 先跑一帧，不把第一次 draw 时驱动的编译算进去
+    frame();
+    glFinish();
+    // 每帧重新开始，不让上一帧最后的状态帮下一帧省掉切换
+    state.invalidate();
+    state.resetCounters();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+    {
+        frame();
+        state.invalidate();
+    }
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    // immediate 每个方块 6 次: program、2 次 glActiveTexture、2 次贴图、VAO
+    stateCalls = mode == Immediate ? 6.0 * scene.quads.size() : (double)state.issued() / frames;
+    return ms;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 10;
+    size_t threads = argc > 2 ? (size_t)atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (threads < 2)
+        threads = 2;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(256, 256, "B08_Draw_Sort", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        printf("failed to initialize GLAD\n");
+        return -1;
+    }
+    glViewport(0, 0, 256, 256);
+    glEnable(GL_DEPTH_TEST);
+
+    Scene scene;
+    createScene(scene);
+
+    printf("%s, %s\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+    printf("%d quads, %d programs, %d texture sets, %d VAOs, %d frames\n\n", quadCount, programCount, textureSetCount,
+           vaoCount, frames);
+    printf("%-22s %10s %16s %9s\n", "mode", "ms/frame", "state calls/f", "speedup");
+    const char *names[] = {"immediate", "filtered", "sorted", "threaded"};
+    double baseline = 0.0;
+    for (int mode = Immediate; mode <= Threaded; ++mode)
+    {
+        double stateCalls = 0.0;
+        double ms = measure(scene, (Mode)mode, frames, threads, stateCalls);
+        if (mode == Immediate)
+            baseline = ms;
+        std::string name = names[mode];
+        if (mode == Threaded)
+            name += " (" + std::to_string(threads) + " threads)";
+        printf("%-22s %10.2f %16.0f %8.2fx\n", name.c_str(), ms, stateCalls, baseline / ms);
+    }
+
+    deleteScene(scene);
+    glfwTerminate();
+    return 0;
+}
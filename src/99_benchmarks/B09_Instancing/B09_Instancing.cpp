@@ -0,0 +1,240 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <learnopengl/shader_s.h>
+#include <learnopengl/instance_buffer.h>
+
+// 用法: B09_Instancing [每个 N 跑的帧数]
+// 同一个方块网格画 N 次 (N = 100 .. 100000)，每个方块有自己的变换、颜色和纹理数组的层：
+//   per-object  每个方块设 3 个 uniform 再调一次 glDrawElements (CH1_01_S2_2Triggle 的写法放大)
+//   instanced   每帧把 N 个 Instance 写进 InstanceBuffer，一次 glDrawElementsInstanced
+// 两种方式每帧都让方块移动一点，instanced 的时间包括每帧的上传。最后比较两种方式画出来的像素是否一样。
+
+static const int layerCount = 4;
+
+static const char *perObjectVertex =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "uniform mat4 transform;\n"
+    "uniform vec4 color;\n"
+    "uniform float layer;\n"
+    "out vec3 uv;\n"
+    "out vec4 tint;\n"
+    "void main()\n"
+    "{\n"
+    "    uv = vec3(aPos * 0.5 + 0.5, layer);\n"
+    "    tint = color;\n"
+    "    gl_Position = transform * vec4(aPos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *instancedVertex =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 3) in mat4 aTransform;\n"
+    "layout (location = 7) in vec4 aColor;\n"
+    "layout (location = 8) in float aLayer;\n"
+    "out vec3 uv;\n"
+    "out vec4 tint;\n"
+    "void main()\n"
+    "{\n"
+    "    uv = vec3(aPos * 0.5 + 0.5, aLayer);\n"
+    "    tint = aColor;\n"
+    "    gl_Position = aTransform * vec4(aPos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentCode =
+    "#version 330 core\n"
+    "in vec3 uv;\n"
+    "in vec4 tint;\n"
+    "uniform sampler2DArray layers;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    FragColor = tint * texture(layers, uv);\n"
+    "}\n";
+
+// 第 frame 帧每个方块的数据
+static void animate(std::vector<Instance> &instances, const std::vector<float> &seeds, int frame)
+{
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        const float *seed = &seeds[i * 4];
+        float x = seed[0] + frame * 0.001f;
+        if (x > 1.0f)
+            x -= 2.0f;
+        instances[i].place(x, seed[1], seed[2], 0.004f + seed[3] * 0.01f);
+    }
+}
+
+static std::vector<unsigned char> readPixels()
+{
+    std::vector<unsigned char> pixels(256 * 256 * 4);
+    glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// 返回每帧的毫秒数
+static double measurePerObject(std::vector<Instance> &instances, const std::vector<float> &seeds, int frames,
+                               std::vector<unsigned char> &image)
+{
+    Shader shader = Shader::fromSource(perObjectVertex, fragmentCode);
+    shader.use();
+    shader.setInt("layers", 0);
+    UniformHandle transform = shader.uniform("transform");
+    UniformHandle color = shader.uniform("color");
+    UniformHandle layer = shader.uniform("layer");
+
+    auto frame = [&](int i) {
+        animate(instances, seeds, i);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        for (const Instance &instance : instances)
+        {
+            shader.setMat4(transform, instance.transform);
+            shader.setVec4(color, instance.color);
+            shader.setFloat(layer, instance.layer);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        }
+    };
+    frame(0);
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= frames; ++i)
+        frame(i);
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    image = readPixels();
+    glDeleteProgram(shader.ID);
+    return ms;
+}
+
+static double measureInstanced(std::vector<Instance> &instances, const std::vector<float> &seeds, int frames,
+                               unsigned int vao, std::vector<unsigned char> &image)
+{
+    Shader shader = Shader::fromSource(instancedVertex, fragmentCode);
+    shader.use();
+    shader.setInt("layers", 0);
+    InstanceBuffer buffer(3, instances.size());
+    buffer.attach(vao);
+
+    auto frame = [&](int i) {
+        animate(instances, seeds, i);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        buffer.update(instances.data(), instances.size());
+        buffer.drawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    };
+    frame(0);
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= frames; ++i)
+        frame(i);
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    image = readPixels();
+    glDeleteProgram(shader.ID);
+    return ms;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 10;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(256, 256, "B09_Instancing", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        printf("failed to initialize GLAD\n");
+        return -1;
+    }
+    glViewport(0, 0, 256, 256);
+
+    // 一个方块网格；两个 VAO 用同一份顶点，instanced 的那个另外接上 InstanceBuffer
+    float vertices[] = {1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f};
+    unsigned int indices[] = {0, 1, 3, 1, 2, 3};
+    unsigned int VAO[2], VBO, EBO;
+    glGenVertexArrays(2, VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindVertexArray(VAO[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+    }
+
+    // 4 层的纹理数组，每层一种颜色
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    std::vector<unsigned char> texels(2 * 2 * 4 * layerCount);
+    for (int i = 0; i < 2 * 2 * layerCount; ++i)
+    {
+        int layer = i / 4;
+        texels[i * 4 + 0] = (unsigned char)(layer & 1 ? 255 : 64);
+        texels[i * 4 + 1] = (unsigned char)(layer & 2 ? 255 : 64);
+        texels[i * 4 + 2] = (unsigned char)(i % 4 * 60 + 60);
+        texels[i * 4 + 3] = 255;
+    }
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 2, 2, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    printf("%s, %s\n\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+    printf("%8s %16s %16s %9s %7s\n", "N", "per-object ms/f", "instanced ms/f", "speedup", "image");
+    const int counts[] = {100, 1000, 10000, 100000};
+    for (int n : counts)
+    {
+        std::mt19937 random(n);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<Instance> instances(n);
+        std::vector<float> seeds((size_t)n * 4);
+        for (int i = 0; i < n; ++i)
+        {
+            seeds[i * 4 + 0] = unit(random) * 2.0f - 1.0f;
+            seeds[i * 4 + 1] = unit(random) * 2.0f - 1.0f;
+            seeds[i * 4 + 2] = 0.0f;
+            seeds[i * 4 + 3] = unit(random);
+            for (int c = 0; c < 3; ++c)
+                instances[i].color[c] = 0.5f + unit(random) * 0.5f;
+            instances[i].layer = (float)(random() % layerCount);
+        }
+        std::vector<unsigned char> perObjectImage, instancedImage;
+        glBindVertexArray(VAO[0]);
+        double perObject = measurePerObject(instances, seeds, frames, perObjectImage);
+        glBindVertexArray(VAO[1]);
+        double instanced = measureInstanced(instances, seeds, frames, VAO[1], instancedImage);
+        printf("%8d %16.2f %16.2f %8.2fx %7s\n", n, perObject, instanced, perObject / instanced,
+               perObjectImage == instancedImage ? "same" : "DIFFERS");
+    }
+
+    glDeleteTextures(1, &texture);
+    glDeleteVertexArrays(2, VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glfwTerminate();
+    return 0;
+}
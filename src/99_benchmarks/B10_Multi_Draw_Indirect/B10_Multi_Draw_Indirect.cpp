@@ -0,0 +1,214 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <learnopengl/shader_s.h>
+#include <learnopengl/geometry_buffer.h>
+
+// 用法: B10_Multi_Draw_Indirect [每个 N 跑的帧数]
+// N 个不同的小多边形 (3 到 8 条边，位置直接写在顶点里)，两种画法：
+//   per-mesh   每个网格自己的 VAO / VBO / EBO，每帧 N 次 glBindVertexArray + glDrawElements (demo 的写法)
+//   indirect   所有网格放进一个 GeometryBuffer，每帧把 N 条命令写进 IndirectDrawBatch，
+//              一次 glMultiDrawElementsIndirect 画完 (不支持时退回逐条 draw，表里会标出调用次数)
+// 最后比较两种方式画出来的像素是否一样。再删掉一半网格、放进新的，看空闲块有没有合并回去。
+
+static const char *vertexCode =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec3 aColor;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = aColor;\n"
+    "    gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentCode =
+    "#version 330 core\n"
+    "in vec3 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    FragColor = vec4(color, 1.0);\n"
+    "}\n";
+
+struct Mesh
+{
+    std::vector<float> vertices; // x, y, r, g, b
+    std::vector<unsigned int> indices;
+};
+
+// 以 (x, y) 为中心的正多边形，三角形扇
+static Mesh makePolygon(std::mt19937 &random)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    Mesh mesh;
+    int sides = 3 + (int)(random() % 6);
+    float x = unit(random) * 2.0f - 1.0f, y = unit(random) * 2.0f - 1.0f, radius = 0.005f + unit(random) * 0.02f;
+    float color[3] = {unit(random), unit(random), unit(random)};
+    for (int i = 0; i < sides; ++i)
+    {
+        float angle = 6.2831853f * i / sides;
+        mesh.vertices.insert(mesh.vertices.end(), {x + radius * cosf(angle), y + radius * sinf(angle), color[0], color[1], color[2]});
+    }
+    for (int i = 1; i + 1 < sides; ++i)
+        mesh.indices.insert(mesh.indices.end(), {0u, (unsigned int)i, (unsigned int)i + 1});
+    return mesh;
+}
+
+static std::vector<unsigned char> readPixels()
+{
+    std::vector<unsigned char> pixels(256 * 256 * 4);
+    glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+template <typename Frame>
+static double timeFrames(int frames, Frame frame)
+{
+    frame();
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+        frame();
+    glFinish();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+// 返回每帧的毫秒数
+static double measurePerMesh(const std::vector<Mesh> &meshes, int frames, std::vector<unsigned char> &image)
+{
+    size_t n = meshes.size();
+    std::vector<unsigned int> vaos(n), vbos(n), ebos(n);
+    glGenVertexArrays((GLsizei)n, vaos.data());
+    glGenBuffers((GLsizei)n, vbos.data());
+    glGenBuffers((GLsizei)n, ebos.data());
+    for (size_t i = 0; i < n; ++i)
+    {
+        glBindVertexArray(vaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vbos[i]);
+        glBufferData(GL_ARRAY_BUFFER, meshes[i].vertices.size() * sizeof(float), meshes[i].vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebos[i]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshes[i].indices.size() * sizeof(unsigned int), meshes[i].indices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    double ms = timeFrames(frames, [&]() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (size_t i = 0; i < n; ++i)
+        {
+            glBindVertexArray(vaos[i]);
+            glDrawElements(GL_TRIANGLES, (GLsizei)meshes[i].indices.size(), GL_UNSIGNED_INT, 0);
+        }
+    });
+    image = readPixels();
+    glBindVertexArray(0);
+    glDeleteVertexArrays((GLsizei)n, vaos.data());
+    glDeleteBuffers((GLsizei)n, vbos.data());
+    glDeleteBuffers((GLsizei)n, ebos.data());
+    return ms;
+}
+
+static double measureIndirect(const std::vector<Mesh> &meshes, int frames, std::vector<unsigned char> &image,
+                              size_t &calls)
+{
+    size_t vertexCount = 0, indexCount = 0;
+    for (const Mesh &mesh : meshes)
+    {
+        vertexCount += mesh.vertices.size() / 5;
+        indexCount += mesh.indices.size();
+    }
+    GeometryBuffer geometry(5 * sizeof(float), vertexCount, indexCount);
+    geometry.attribute(0, 2, GL_FLOAT, 0);
+    geometry.attribute(1, 3, GL_FLOAT, 2 * sizeof(float));
+    std::vector<MeshRange> ranges;
+    for (const Mesh &mesh : meshes)
+        ranges.push_back(geometry.add(mesh.vertices.data(), mesh.vertices.size() / 5, mesh.indices.data(), mesh.indices.size()));
+
+    IndirectDrawBatch batch;
+    double ms = timeFrames(frames, [&]() {
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (const MeshRange &range : ranges)
+            batch.draw(range);
+        calls = batch.submit(geometry);
+    });
+    image = readPixels();
+
+    // 删掉每隔一个的网格再放回去：空出来的块都应该被重新用上
+    for (size_t i = 0; i < ranges.size(); i += 2)
+        geometry.remove(ranges[i]);
+    size_t holes = geometry.vertexSpace().freeBlockCount();
+    for (size_t i = 0; i < ranges.size(); i += 2)
+        ranges[i] = geometry.add(meshes[i].vertices.data(), meshes[i].vertices.size() / 5, meshes[i].indices.data(), meshes[i].indices.size());
+    bool refilled = geometry.vertexSpace().used() == vertexCount && geometry.indexSpace().used() == indexCount;
+    for (MeshRange &range : ranges)
+        geometry.remove(range);
+    bool merged = geometry.vertexSpace().freeBlockCount() == 1 && geometry.indexSpace().freeBlockCount() == 1;
+    if (!refilled || !merged)
+        printf("free list: %zu holes after removing half, refilled %s, merged back %s\n", holes, refilled ? "yes" : "NO",
+               merged ? "yes" : "NO");
+    glBindVertexArray(0);
+    return ms;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 20;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(256, 256, "B10_Multi_Draw_Indirect", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        printf("failed to initialize GLAD\n");
+        return -1;
+    }
+    glViewport(0, 0, 256, 256);
+
+    Shader shader = Shader::fromSource(vertexCode, fragmentCode);
+    shader.use();
+
+    printf("%s, %s\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+    printf("indirect draws through %s\n\n", IndirectDrawBatch::multiDrawSupported() ? "glMultiDrawElementsIndirect"
+                                            : GLAD_GL_ARB_draw_indirect           ? "glDrawElementsIndirect"
+                                                                                  : "glDrawElementsInstancedBaseVertex");
+    printf("%8s %14s %14s %12s %9s %7s\n", "N", "per-mesh ms/f", "indirect ms/f", "calls/pass", "speedup", "image");
+    const int counts[] = {100, 1000, 10000, 50000};
+    for (int n : counts)
+    {
+        std::mt19937 random(n);
+        std::vector<Mesh> meshes;
+        for (int i = 0; i < n; ++i)
+            meshes.push_back(makePolygon(random));
+        std::vector<unsigned char> perMeshImage, indirectImage;
+        size_t calls = 0;
+        double perMesh = measurePerMesh(meshes, frames, perMeshImage);
+        double indirect = measureIndirect(meshes, frames, indirectImage, calls);
+        printf("%8d %14.2f %14.2f %12zu %8.2fx %7s\n", n, perMesh, indirect, calls, perMesh / indirect,
+               perMeshImage == indirectImage ? "same" : "DIFFERS");
+    }
+
+    glDeleteProgram(shader.ID);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include <learnopengl/shader_s.h>
+#include <learnopengl/stream_buffer.h>
+
+// 用法: B11_Stream_Vertices [每个 N 跑的帧数]
+// 每帧在 CPU 上重新算一张 N 个顶点的波浪网格 (位置 + 颜色)，用三种方式交给 GL 再画出来：
+//   subdata     同一个 VBO，每帧 glBufferSubData 覆盖 (GPU 还在读上一帧时驱动要等或者复制)
+//   orphan      每帧先 glBufferData(NULL) 丢掉旧的存储，再 glBufferSubData
+//   ring        StreamBuffer：三段轮流用，直接写进映射的内存，fence 保证不覆盖 GPU 还在读的那段
+// 表里是每帧的毫秒数、ring 每秒写入的 MB 数和等 fence 的次数；最后一帧的像素三种方式应该一样。
+
+static const char *vertexCode =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec3 aColor;\n"
+    "out vec3 color;\n"
+    "void main()\n"
+    "{\n"
+    "    color = aColor;\n"
+    "    gl_Position = vec4(aPos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentCode =
+    "#version 330 core\n"
+    "in vec3 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    FragColor = vec4(color, 1.0);\n"
+    "}\n";
+
+static const int floatsPerVertex = 5;
+
+// side * side 个顶点，按第 frame 帧起伏
+static void animate(float *vertices, int side, int frame)
+{
+    float t = frame * 0.05f;
+    for (int y = 0; y < side; ++y)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            float u = (float)x / (side - 1), v = (float)y / (side - 1);
+            float wave = sinf(u * 12.0f + t) * cosf(v * 9.0f - t);
+            float *p = vertices + (y * side + x) * floatsPerVertex;
+            p[0] = u * 1.8f - 0.9f;
+            p[1] = v * 1.8f - 0.9f + wave * 0.02f;
+            p[2] = 0.5f + wave * 0.5f;
+            p[3] = u;
+            p[4] = v;
+        }
+    }
+}
+
+static void attributes(size_t offset)
+{
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void *)offset);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void *)(offset + 2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+}
+
+enum Mode
+{
+    SubData,
+    Orphan,
+    Ring
+};
+
+struct Result
+{
+    double ms;
+    double megabytesPerSecond;
+    unsigned long long fenceWaits;
+    std::vector<unsigned char> image;
+};
+
+static Result measure(Mode mode, int side, int frames)
+{
+    int count = side * side;
+    size_t bytes = (size_t)count * floatsPerVertex * sizeof(float);
+    std::vector<float> scratch((size_t)count * floatsPerVertex);
+    unsigned int VAO, VBO = 0;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    StreamBuffer *ring = nullptr;
+    if (mode == Ring)
+        ring = new StreamBuffer(bytes);
+    else
+    {
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        attributes(0);
+    }
+
+    auto frame = [&](int i) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (mode == Ring)
+        {
+            // 直接算进映射的内存，不经过 scratch
+            ring->beginFrame();
+            StreamRange range = ring->allocate(bytes, sizeof(float));
+            animate((float *)range.data, side, i);
+            ring->flush();
+            glBindBuffer(GL_ARRAY_BUFFER, ring->id());
+            attributes(range.offset);
+        }
+        else
+        {
+            animate(scratch.data(), side, i);
+            if (mode == Orphan)
+                glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, scratch.data());
+        }
+        glDrawArrays(GL_POINTS, 0, count);
+    };
+    frame(0);
+    glFinish();
+    if (ring)
+        ring->resetCounters();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= frames; ++i)
+        frame(i);
+    glFinish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result result;
+    result.ms = seconds * 1000.0 / frames;
+    result.megabytesPerSecond = (ring ? ring->bytesStreamed() : (double)bytes * frames) / seconds / (1024.0 * 1024.0);
+    result.fenceWaits = ring ? ring->fenceWaits() : 0;
+    result.image.resize(256 * 256 * 4);
+    glReadPixels(0, 0, 256, 256, GL_RGBA, GL_UNSIGNED_BYTE, result.image.data());
+
+    delete ring;
+    if (VBO)
+        glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 100;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(256, 256, "B11_Stream_Vertices", NULL, NULL);
+    if (window == NULL)
+    {
+        printf("failed to create GLFW window\n");
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        printf("failed to initialize GLAD\n");
+        return -1;
+    }
+    glViewport(0, 0, 256, 256);
+
+    Shader shader = Shader::fromSource(vertexCode, fragmentCode);
+    shader.use();
+
+    printf("%s, %s\n", (const char *)glGetString(GL_RENDERER), (const char *)glGetString(GL_VERSION));
+    printf("ring writes through %s\n\n", GLAD_GL_ARB_buffer_storage ? "a persistent mapping" : "an unsynchronized mapping");
+    printf("%8s %10s %12s %12s %10s %11s %9s %7s\n", "vertices", "KB/frame", "subdata ms/f", "orphan ms/f", "ring ms/f",
+           "ring MB/s", "waits", "image");
+    const int sides[] = {32, 100, 320, 1000};
+    for (int side : sides)
+    {
+        Result subData = measure(SubData, side, frames);
+        Result orphan = measure(Orphan, side, frames);
+        Result ring = measure(Ring, side, frames);
+        bool same = subData.image == orphan.image && orphan.image == ring.image;
+        printf("%8d %10.0f %12.3f %12.3f %10.3f %11.0f %9llu %7s\n", side * side,
+               side * side * floatsPerVertex * sizeof(float) / 1024.0, subData.ms, orphan.ms, ring.ms,
+               ring.megabytesPerSecond, ring.fenceWaits, same ? "same" : "DIFFERS");
+    }
+
+    glDeleteProgram(shader.ID);
+    glfwTerminate();
+    return 0;
+}
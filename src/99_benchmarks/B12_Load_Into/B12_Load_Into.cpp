@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+
+#include <learnopengl/filesystem.h>
+
+// 用法: B12_Load_Into [每个文件解码的 MB 数]
+// 先检查 stbi_load_from_memory_into：resources/textures 里的纹理，加上在内存里生成的 TGA、GIF、PIC
+// (resources 里没有这几种格式)，解码进一块行宽不对齐的内存、翻转或不翻转，都要和 stbi_load 的结果一样。
+// 检查通过后再对比两种把图片放进行宽对齐的目标内存 (比如映射好的 PBO) 的方式：
+// stbi_load_from_memory 之后逐行拷贝，和 stbi_load_from_memory_into 直接解码进去。
+// 文件先整个读进内存，测的只是解码和拷贝。
+
+static bool readFile(const std::string &path, std::vector<unsigned char> &data)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+    fseek(f, 0, SEEK_END);
+    data.resize((size_t)ftell(f));
+    fseek(f, 0, SEEK_SET);
+    bool ok = fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+// 生成测试图用的 128 色调色板，第 i 个颜色
+static void paletteColor(int i, unsigned char rgb[3])
+{
+    rgb[0] = (unsigned char)(i * 2);
+    rgb[1] = (unsigned char)(255 - i * 2);
+    rgb[2] = (unsigned char)(i * 37);
+}
+
+// (x, y) 处的调色板下标，y = 0 是最上面一行
+static int patternIndex(int x, int y)
+{
+    return (x * 3 + y * 5 + x * y) % 128;
+}
+
+static void put16le(std::vector<unsigned char> &out, int v)
+{
+    out.push_back((unsigned char)(v & 255));
+    out.push_back((unsigned char)(v >> 8));
+}
+
+static void put16be(std::vector<unsigned char> &out, int v)
+{
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)(v & 255));
+}
+
+// rle 为 false 时是 24 位、从下往上存的行；为 true 时是 32 位带 alpha、从上往下、RLE 压缩
+static std::vector<unsigned char> makeTGA(int w, int h, bool rle)
+{
+    std::vector<unsigned char> out = { 0, 0, (unsigned char)(rle ? 10 : 2), 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    put16le(out, w);
+    put16le(out, h);
+    out.push_back(rle ? 32 : 24);
+    out.push_back(rle ? 0x28 : 0x00); // 0x20: 第一行在最上面；低 4 位: alpha 位数
+    std::vector<unsigned char> pixels;
+    for (int row = 0; row < h; ++row)
+    {
+        int y = rle ? row : h - 1 - row;
+        for (int x = 0; x < w; ++x)
+        {
+            unsigned char rgb[3];
+            paletteColor(patternIndex(x, y), rgb);
+            pixels.insert(pixels.end(), { rgb[2], rgb[1], rgb[0] }); // BGR
+            if (rle)
+                pixels.push_back((unsigned char)(x * y));
+        }
+    }
+    if (!rle)
+    {
+        out.insert(out.end(), pixels.begin(), pixels.end());
+        return out;
+    }
+    // 相同的像素连成一个 run 包，其余的一个像素一个 raw 包
+    size_t count = pixels.size() / 4;
+    for (size_t i = 0; i < count;)
+    {
+        size_t run = 1;
+        while (i + run < count && run < 128 && memcmp(&pixels[i * 4], &pixels[(i + run) * 4], 4) == 0)
+            ++run;
+        out.push_back((unsigned char)(run > 1 ? 0x80 | (run - 1) : 0));
+        out.insert(out.end(), pixels.begin() + i * 4, pixels.begin() + i * 4 + 4);
+        i += run;
+    }
+    return out;
+}
+
+// 128 色的 GIF。LZW 码长固定 8 位：每 100 个码发一次 clear，字典永远长不到 256 项，
+// 每个码就是一个像素
+static std::vector<unsigned char> makeGIF(int w, int h)
+{
+    std::vector<unsigned char> out = { 'G', 'I', 'F', '8', '9', 'a' };
+    put16le(out, w);
+    put16le(out, h);
+    out.insert(out.end(), { 0x86, 0, 0 }); // 全局调色板，2^(6+1) = 128 色
+    for (int i = 0; i < 128; ++i)
+    {
+        unsigned char rgb[3];
+        paletteColor(i, rgb);
+        out.insert(out.end(), rgb, rgb + 3);
+    }
+    out.push_back(0x2c);
+    put16le(out, 0);
+    put16le(out, 0);
+    put16le(out, w);
+    put16le(out, h);
+    out.push_back(0);
+    out.push_back(7); // 最小码长
+    std::vector<unsigned char> codes;
+    const int clear = 128, end = 129;
+    codes.push_back(clear);
+    for (int i = 0; i < w * h; ++i)
+    {
+        if (i > 0 && i % 100 == 0)
+            codes.push_back(clear);
+        codes.push_back((unsigned char)patternIndex(i % w, i / w));
+    }
+    codes.push_back(end);
+    // 8 位的码正好一个字节，按最多 255 字节一块写出去
+    for (size_t i = 0; i < codes.size(); i += 255)
+    {
+        size_t n = codes.size() - i < 255 ? codes.size() - i : 255;
+        out.push_back((unsigned char)n);
+        out.insert(out.end(), codes.begin() + i, codes.begin() + i + n);
+    }
+    out.push_back(0);
+    out.push_back(0x3b);
+    return out;
+}
+
+// Softimage PIC，一个不压缩的 RGB 通道包
+static std::vector<unsigned char> makePIC(int w, int h)
+{
+    std::vector<unsigned char> out = { 0x53, 0x80, 0xf6, 0x34 };
+    out.resize(88, 0);
+    out.insert(out.end(), { 'P', 'I', 'C', 'T' });
+    put16be(out, w);
+    put16be(out, h);
+    out.insert(out.end(), { 0x3f, 0x80, 0, 0, 0, 3, 0, 0 }); // ratio 1.0, fields, pad
+    out.insert(out.end(), { 0, 8, 0, 0xe0 });               // 不串联, 8 位, 不压缩, R|G|B
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            unsigned char rgb[3];
+            paletteColor(patternIndex(x, y), rgb);
+            out.insert(out.end(), rgb, rgb + 3);
+        }
+    }
+    return out;
+}
+
+// 用 stbi_load_from_memory_into 解码进行宽多出 7 字节、大小刚好的内存，翻转和不翻转各一次，
+// 和 stbi_load_from_memory 的结果逐行比较。返回 "same"、"DIFFERS" 或失败原因
+static const char *checkInto(const std::vector<unsigned char> &file, int req)
+{
+    for (int flip = 0; flip < 2; ++flip)
+    {
+        int w, h, n;
+        unsigned char *expected = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &n, req);
+        if (!expected)
+            return stbi_failure_reason();
+        int channels = req ? req : n;
+        size_t rowBytes = (size_t)w * channels;
+        int stride = (int)rowBytes + 7;
+        std::vector<unsigned char> target((size_t)stride * (h - 1) + rowBytes);
+        int x, y, comp;
+        if (!stbi_load_from_memory_into(file.data(), (int)file.size(), target.data(), target.size(), stride, &x, &y,
+                                        &comp, req, flip))
+        {
+            stbi_image_free(expected);
+            return stbi_failure_reason();
+        }
+        bool same = x == w && y == h && comp == n;
+        for (int row = 0; row < h && same; ++row)
+        {
+            const unsigned char *want = expected + rowBytes * (flip ? h - 1 - row : row);
+            same = memcmp(&target[(size_t)stride * row], want, rowBytes) == 0;
+        }
+        stbi_image_free(expected);
+        if (!same)
+            return "DIFFERS";
+    }
+    return "same";
+}
+
+// 解码进目标内存时的行宽，按 GL_UNPACK_ALIGNMENT 的默认值 4 对齐
+static int alignedStride(int w, int channels)
+{
+    return (w * channels + 3) & ~3;
+}
+
+// 返回每秒解码出的像素 MB 数
+static double measureCopy(const std::vector<unsigned char> &file, std::vector<unsigned char> &target, int iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        int w, h, n;
+        unsigned char *data = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &n, 0);
+        if (!data)
+            return 0.0;
+        size_t rowBytes = (size_t)w * n;
+        int stride = alignedStride(w, n);
+        for (int row = 0; row < h; ++row)
+            memcpy(&target[(size_t)stride * row], data + rowBytes * row, rowBytes);
+        stbi_image_free(data);
+        bytes += rowBytes * h;
+    }
+    return bytes / (1024.0 * 1024.0) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double measureInto(const std::vector<unsigned char> &file, std::vector<unsigned char> &target, int stride,
+                          int iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        int w, h, n;
+        if (!stbi_load_from_memory_into(file.data(), (int)file.size(), target.data(), target.size(), stride, &w, &h,
+                                        &n, 0, 0))
+            return 0.0;
+        bytes += (size_t)w * n * h;
+    }
+    return bytes / (1024.0 * 1024.0) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int decodeMB = argc > 1 ? atoi(argv[1]) : 256;
+    const char *textures[] = { "awesomeface.png", "background.jpg", "brickwall.jpg", "brickwall_normal.jpg",
+                               "concreteTexture.png", "container.jpg", "container2.png", "grass.png" };
+
+    std::vector<std::vector<unsigned char>> files(sizeof(textures) / sizeof(textures[0]));
+    printf("%-32s %10s %10s\n", "stbi_load_into", "n = 0", "n = 4");
+    bool allSame = true;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (!readFile(FileSystem::getPath(std::string("resources/textures/") + textures[i]), files[i]))
+        {
+            printf("%-32s can't open\n", textures[i]);
+            continue;
+        }
+        const char *any = checkInto(files[i], 0), *rgba = checkInto(files[i], 4);
+        allSame = allSame && strcmp(any, "same") == 0 && strcmp(rgba, "same") == 0;
+        printf("%-32s %10s %10s\n", textures[i], any, rgba);
+    }
+    // 奇数宽度，RGB 的行不是 4 字节对齐的
+    const struct
+    {
+        const char *name;
+        std::vector<unsigned char> file;
+    } generated[] = { { "generated 37x23 tga", makeTGA(37, 23, false) },
+                      { "generated 37x23 tga, rle", makeTGA(37, 23, true) },
+                      { "generated 37x23 gif", makeGIF(37, 23) },
+                      { "generated 37x23 pic", makePIC(37, 23) } };
+    for (const auto &sample : generated)
+    {
+        const char *any = checkInto(sample.file, 0), *rgba = checkInto(sample.file, 4);
+        allSame = allSame && strcmp(any, "same") == 0 && strcmp(rgba, "same") == 0;
+        printf("%-32s %10s %10s\n", sample.name, any, rgba);
+    }
+    if (!allSame)
+        return 1;
+
+    printf("\n%-32s %10s %12s %12s %9s\n", "file", "MB", "copy MB/s", "into MB/s", "speedup");
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        int w, h, n;
+        if (files[i].empty() || !stbi_info_from_memory(files[i].data(), (int)files[i].size(), &w, &h, &n))
+            continue;
+        int stride = alignedStride(w, n);
+        std::vector<unsigned char> target((size_t)stride * h);
+        double imageMB = (double)w * h * n / (1024.0 * 1024.0);
+        int iterations = (int)(decodeMB / imageMB) + 1;
+        // 两种方式都先预热一次
+        measureCopy(files[i], target, 1);
+        measureInto(files[i], target, stride, 1);
+        double copySpeed = measureCopy(files[i], target, iterations);
+        double intoSpeed = measureInto(files[i], target, stride, iterations);
+        printf("%-32s %10.1f %12.1f %12.1f %8.2fx\n", textures[i], imageMB, copySpeed, intoSpeed,
+               copySpeed > 0.0 ? intoSpeed / copySpeed : 0.0);
+    }
+    return 0;
+}